@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Synthetic UI documents for the parser benchmarks. Every shape produces (close to) the requested number of nodes.
+//   wide -> rows of 1000 siblings under the root
+//   deep -> chains that nest 30 layers below the root
+//   text -> rows of text nodes holding sentences, some of them split by newlines
+//   attr -> rows of nodes that carry the size, growth and alignment properties
+// Child counts are 16 bit, so every shape keeps the root's direct children in range.
+
+enum Document_Shape
+{
+    DOCUMENT_WIDE,
+    DOCUMENT_DEEP,
+    DOCUMENT_TEXT,
+    DOCUMENT_ATTR,
+    DOCUMENT_SHAPE_COUNT
+};
+
+static const char* Document_Shape_Names[DOCUMENT_SHAPE_COUNT] = { "wide", "deep", "text", "attr" };
+
+#define DOCUMENT_WIDE_ROW 1000
+#define DOCUMENT_DEEP_CHAIN 30
+
+struct Document_Writer
+{
+    char* data;
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t seed;
+};
+
+static void Document_Reserve(struct Document_Writer* writer, uint32_t extra)
+{
+    if (writer->length + extra <= writer->capacity) return;
+    while (writer->length + extra > writer->capacity) writer->capacity *= 2;
+    writer->data = realloc(writer->data, writer->capacity);
+}
+
+static void Document_Append(struct Document_Writer* writer, const char* text)
+{
+    uint32_t text_length = strlen(text);
+    Document_Reserve(writer, text_length);
+    memcpy(writer->data + writer->length, text, text_length);
+    writer->length += text_length;
+}
+
+// Small xorshift so documents are identical between runs and machines
+static uint32_t Document_Random(struct Document_Writer* writer, uint32_t range)
+{
+    uint32_t x = writer->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    writer->seed = x;
+    return x % range;
+}
+
+static void Document_Append_Attributes(struct Document_Writer* writer)
+{
+    static const char* alignments[3] = { "left", "center", "right" };
+    char attributes[256];
+    sprintf(attributes, " width=\"%u\" height=\"%u.%u\" minWidth=\"%u\" maxWidth=\"%u\" minHeight=\"%u\" maxHeight=\"%u\" alignH=\"%s\" alignV=\"%s\"",
+        1 + Document_Random(writer, 999), 1 + Document_Random(writer, 99), Document_Random(writer, 100),
+        Document_Random(writer, 50), 100 + Document_Random(writer, 1900),
+        Document_Random(writer, 10), 200 + Document_Random(writer, 700),
+        alignments[Document_Random(writer, 3)], alignments[Document_Random(writer, 3)]);
+    Document_Append(writer, attributes);
+}
+
+static void Document_Append_Sentence(struct Document_Writer* writer)
+{
+    static const char* words[8] = { "order", "price", "quantity", "settled", "pending", "account", "balance", "transfer" };
+    uint32_t word_count = 6 + Document_Random(writer, 8);
+    for (uint32_t w=0; w<word_count; w++)
+    {
+        if (w > 0) Document_Append(writer, Document_Random(writer, 16) == 0 ? "\n            " : " ");
+        Document_Append(writer, words[Document_Random(writer, 8)]);
+    }
+}
+
+// Returns a malloc'd (not null terminated) document with close to node_count nodes
+static char* Generate_Document(enum Document_Shape shape, uint32_t node_count, uint32_t* length_out)
+{
+    struct Document_Writer writer;
+    writer.capacity = 1 << 16;
+    writer.data = malloc(writer.capacity);
+    writer.length = 0;
+    writer.seed = 2463534242u;
+
+    Document_Append(&writer, "<window dir=\"v\">\n");
+    uint32_t nodes = 1;
+    while (nodes < node_count)
+    {
+        switch (shape)
+        {
+            case DOCUMENT_WIDE:
+            {
+                Document_Append(&writer, "    <rect dir=\"h\">\n");
+                nodes++;
+                for (uint32_t c=0; c<DOCUMENT_WIDE_ROW && nodes < node_count; c++, nodes++) {
+                    Document_Append(&writer, "        <rect/>\n");
+                }
+                Document_Append(&writer, "    </rect>\n");
+                break;
+            }
+            case DOCUMENT_DEEP:
+            {
+                uint32_t depth = 0;
+                for (; depth<DOCUMENT_DEEP_CHAIN && nodes < node_count; depth++, nodes++) {
+                    Document_Append(&writer, "<rect>");
+                }
+                for (uint32_t d=0; d<depth; d++) {
+                    Document_Append(&writer, "</rect>");
+                }
+                Document_Append(&writer, "\n");
+                break;
+            }
+            case DOCUMENT_TEXT:
+            {
+                Document_Append(&writer, "    <rect dir=\"v\">\n");
+                nodes++;
+                for (uint32_t c=0; c<DOCUMENT_WIDE_ROW && nodes < node_count; c++, nodes++) {
+                    Document_Append(&writer, "        <text>");
+                    Document_Append_Sentence(&writer);
+                    Document_Append(&writer, "</text>\n");
+                }
+                Document_Append(&writer, "    </rect>\n");
+                break;
+            }
+            default:
+            {
+                Document_Append(&writer, "    <rect dir=\"h\">\n");
+                nodes++;
+                for (uint32_t c=0; c<DOCUMENT_WIDE_ROW && nodes < node_count; c++, nodes++) {
+                    Document_Append(&writer, "        <rect");
+                    Document_Append_Attributes(&writer);
+                    Document_Append(&writer, "/>\n");
+                }
+                Document_Append(&writer, "    </rect>\n");
+                break;
+            }
+        }
+    }
+    Document_Append(&writer, "</window>");
+    *length_out = writer.length;
+    return writer.data;
+}
@@ -0,0 +1,279 @@
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+// min / max come from the Windows C runtime's stdlib.h, layout.h uses them
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#include "parser.h"
+#include "layout.h"
+#include "document_generator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Full layout of a 100k node tree on the layout pool, per thread count (1, 2, 4 ... up to the logical cores)
+// against the serial passes NU_Render runs without a pool. Every pool layout is checked against the serial one
+// (node positions and sizes, text row counts).
+// Usage: layout_benchmark [max_threads] [node_count]
+//
+// No window is opened and no font is loaded: nanovg is replaced by the stubs below, which measure text as
+// fixed width glyphs (so every font context is a stub and the text passes still break every text's rows).
+// The root window is laid out as a plain rect, its width changes every run so all the text is broken again.
+
+#define BENCHMARK_RUNS 5
+#define BENCHMARK_TREE_NODES 100000
+#define BENCHMARK_GLYPH_WIDTH 8.0f
+#define BENCHMARK_LINE_HEIGHT 20.0f
+
+static double Bench_Seconds()
+{
+    #ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+    #else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+    #endif
+}
+
+// Stub nanovg ----------------------------------------------------------
+static char bench_context; // every context is this one, the stubs keep no state
+
+NVGcontext* nvgCreateInternal(NVGparams* params) { return (NVGcontext*) &bench_context; }
+void nvgDeleteInternal(NVGcontext* ctx) {}
+NVGparams* nvgInternalParams(NVGcontext* ctx) { return NULL; }
+int nvgCreateFontMem(NVGcontext* ctx, const char* name, unsigned char* data, int ndata, int freeData) { return 0; }
+void nvgFontFaceId(NVGcontext* ctx, int font) {}
+void nvgFontSize(NVGcontext* ctx, float size) {}
+void nvgTextAlign(NVGcontext* ctx, int align) {}
+
+float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds)
+{
+    if (end == NULL) end = string + strlen(string);
+    float width = BENCHMARK_GLYPH_WIDTH * (float)(end - string);
+    if (bounds != NULL)
+    {
+        bounds[0] = x;
+        bounds[1] = y;
+        bounds[2] = x + width;
+        bounds[3] = y + BENCHMARK_LINE_HEIGHT;
+    }
+    return width;
+}
+
+void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* lineh)
+{
+    if (ascender != NULL) *ascender = BENCHMARK_LINE_HEIGHT * 0.75f;
+    if (descender != NULL) *descender = -BENCHMARK_LINE_HEIGHT * 0.25f;
+    if (lineh != NULL) *lineh = BENCHMARK_LINE_HEIGHT;
+}
+
+// Greedy word wrap at break_row_width (a word wider than a row gets a row of its own)
+int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float break_row_width, NVGtextRow* rows, int max_rows)
+{
+    if (end == NULL) end = string + strlen(string);
+    int row_count = 0;
+    while (string < end && row_count < max_rows)
+    {
+        while (string < end && *string == ' ') string++;
+        if (string >= end) break;
+        const char* row_end = NULL;
+        const char* next = string;
+        while (next < end)
+        {
+            const char* word_end = next;
+            while (word_end < end && *word_end != ' ') word_end++;
+            if (row_end != NULL && BENCHMARK_GLYPH_WIDTH * (float)(word_end - string) > break_row_width) break;
+            row_end = word_end;
+            next = word_end;
+            while (next < end && *next == ' ') next++;
+        }
+        NVGtextRow* row = &rows[row_count++];
+        row->start = string;
+        row->end = row_end;
+        row->next = next;
+        row->width = BENCHMARK_GLYPH_WIDTH * (float)(row_end - string);
+        row->minx = 0.0f;
+        row->maxx = row->width;
+        string = next;
+    }
+    return row_count;
+}
+
+// Drawing is never reached (the GL renderer in nanovg_gl.h still needs the transform functions to link)
+float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end) { return 0.0f; }
+NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { NVGcolor color; color.r = r / 255.0f; color.g = g / 255.0f; color.b = b / 255.0f; color.a = a / 255.0f; return color; }
+NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b) { return nvgRGBA(r, g, b, 255); }
+void nvgBeginFrame(NVGcontext* ctx, float window_width, float window_height, float device_pixel_ratio) {}
+void nvgEndFrame(NVGcontext* ctx) {}
+void nvgBeginPath(NVGcontext* ctx) {}
+void nvgRect(NVGcontext* ctx, float x, float y, float w, float h) {}
+void nvgRoundedRectVarying(NVGcontext* ctx, float x, float y, float w, float h, float tl, float tr, float br, float bl) {}
+void nvgFillColor(NVGcontext* ctx, NVGcolor color) {}
+void nvgFill(NVGcontext* ctx) {}
+void nvgStrokeColor(NVGcontext* ctx, NVGcolor color) {}
+void nvgStrokeWidth(NVGcontext* ctx, float size) {}
+void nvgStroke(NVGcontext* ctx) {}
+void nvgTransformTranslate(float* dst, float tx, float ty) {}
+void nvgTransformScale(float* dst, float sx, float sy) {}
+void nvgTransformMultiply(float* dst, const float* src) {}
+int nvgTransformInverse(float* dst, const float* src) { return 0; }
+// Stub nanovg ----------------------------------------------------------
+
+static int Bench_Load_Tree(char* src_buffer, uint32_t src_length, struct UI_Tree* ui_tree)
+{
+    memset(ui_tree, 0, sizeof(struct UI_Tree));
+    if (NU_Parse_Buffer(src_buffer, src_length, ui_tree) != 0) return -1; // text is copied, the tree owns it
+    Vector_Reserve(&ui_tree->font_resources, sizeof(struct Font_Resource), 1);
+    struct Vector font_registry;
+    Vector_Reserve(&font_registry, sizeof(int), 1);
+    int fontID = 0;
+    Vector_Push(&font_registry, &fontID);
+    Vector_Reserve(&ui_tree->font_registries, sizeof(struct Vector), 1);
+    Vector_Push(&ui_tree->font_registries, &font_registry);
+
+    // The root window as a rect -> no window is created
+    struct Node* root = Vector_Get_Node(&ui_tree->tree_stack[0], 0);
+    root->tag = RECT;
+    root->width_unit = UNIT_PX;
+    root->height_unit = UNIT_PX;
+    root->preferred_height = 1080.0f;
+    return 0;
+}
+
+static void Bench_Free_Tree(struct UI_Tree* ui_tree)
+{
+    Vector_Free(Vector_Get(&ui_tree->font_registries, 0));
+    Vector_Free(&ui_tree->font_registries);
+    Vector_Free(&ui_tree->font_resources);
+    NU_Free_UI_Tree_Memory(ui_tree);
+}
+
+// thread_count 0 -> the serial passes. The tree is left with the last run's layout.
+static double Bench_Layout(struct UI_Tree* ui_tree, int thread_count)
+{
+    struct NU_Layout_Pool pool;
+    if (thread_count > 0 && NU_Layout_Pool_Init(&pool, ui_tree, thread_count) != 0) return 0.0;
+    if (thread_count > 0 && pool.thread_count != thread_count) {
+        printf("[Benchmark] Error! The pool started %d of %d threads\n", pool.thread_count, thread_count);
+        return 0.0;
+    }
+    struct Vector windows, gl_contexts, nano_vg_contexts;
+    Vector_Reserve(&windows, sizeof(SDL_Window*), 1);
+    Vector_Reserve(&gl_contexts, sizeof(SDL_GLContext), 1);
+    Vector_Reserve(&nano_vg_contexts, sizeof(NVGcontext*), 1);
+
+    double best_seconds = 1e20;
+    for (int run=0; run<=BENCHMARK_RUNS; run++)
+    {
+        struct Node* root = Vector_Get_Node(&ui_tree->tree_stack[0], 0);
+        root->preferred_width = (run % 2 == 0) ? 1920.0f : 1600.0f;
+        NU_Mark_Tree_Dirty(ui_tree);
+
+        double start = Bench_Seconds();
+        if (thread_count > 0) {
+            NU_Layout_Parallel(&pool, ui_tree, &windows, &gl_contexts, &nano_vg_contexts);
+        }
+        else
+        {
+            NU_Clear_Node_Sizes(ui_tree, &windows, &gl_contexts, &nano_vg_contexts);
+            NU_Calculate_Text_Fit_Sizes(ui_tree);
+            NU_Calculate_Fit_Size_Widths(ui_tree);
+            NU_Grow_Shrink_Widths(ui_tree);
+            NU_Calculate_Text_Wrap_Heights(ui_tree, &windows, &gl_contexts, &nano_vg_contexts);
+            NU_Calculate_Fit_Size_Heights(ui_tree);
+            NU_Grow_Shrink_Heights(ui_tree);
+            NU_Calculate_Positions(ui_tree);
+        }
+        double seconds = Bench_Seconds() - start;
+        if (run > 0) best_seconds = MIN(best_seconds, seconds); // the first run also fills the text caches
+    }
+
+    if (thread_count > 0) NU_Layout_Pool_Close(&pool, ui_tree);
+    Vector_Free(&windows);
+    Vector_Free(&gl_contexts);
+    Vector_Free(&nano_vg_contexts);
+    return best_seconds;
+}
+
+// Checks a pool layout against the serial one (both trees parsed from the same source): every node's position
+// and size and every text's row count. Returns the number of mismatches (the first few are printed).
+static uint32_t Bench_Compare_Layout(struct UI_Tree* serial_tree, struct UI_Tree* ui_tree, int thread_count)
+{
+    uint32_t mismatches = 0;
+    for (int l=0; l<=serial_tree->deepest_layer; l++)
+    {
+        for (uint32_t n=0; n<serial_tree->tree_stack[l].size; n++)
+        {
+            struct Node* expected = Vector_Get_Node(&serial_tree->tree_stack[l], n);
+            struct Node* node = Vector_Get_Node(&ui_tree->tree_stack[l], n);
+            if (expected->x == node->x && expected->y == node->y && expected->width == node->width && expected->height == node->height) continue;
+            if (mismatches++ < 4) {
+                printf("[Benchmark] Error! %d threads: node %d:%u at %g %g %gx%g, serial %g %g %gx%g\n", thread_count, l, n,
+                       node->x, node->y, node->width, node->height, expected->x, expected->y, expected->width, expected->height);
+            }
+        }
+    }
+    for (uint32_t i=0; i<serial_tree->text_arena.text_refs.size; i++)
+    {
+        struct Text_Ref* expected = Vector_Get_Text_Ref(&serial_tree->text_arena.text_refs, i);
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, i);
+        if (expected->row_count == text_ref->row_count) continue;
+        if (mismatches++ < 4) {
+            printf("[Benchmark] Error! %d threads: text %u has %u rows, serial %u\n", thread_count, i, text_ref->row_count, expected->row_count);
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    int max_threads = SDL_GetNumLogicalCPUCores();
+    uint32_t node_count = BENCHMARK_TREE_NODES;
+    if (argc > 1) max_threads = atoi(argv[1]);
+    if (argc > 2) node_count = (uint32_t) strtoul(argv[2], NULL, 10);
+    max_threads = MIN(MAX(max_threads, 1), NU_LAYOUT_MAX_THREADS);
+
+    printf("Full layout, %u nodes, milliseconds per layout (best of %d runs), speedup over 1 thread\n", node_count, BENCHMARK_RUNS);
+    printf("  shape | threads        ms  speedup\n");
+    enum Document_Shape shapes[3] = { DOCUMENT_WIDE, DOCUMENT_DEEP, DOCUMENT_TEXT };
+    for (int s=0; s<3; s++)
+    {
+        uint32_t src_length;
+        char* src_buffer = Generate_Document(shapes[s], node_count, &src_length);
+        struct UI_Tree serial_tree;
+        if (Bench_Load_Tree(src_buffer, src_length, &serial_tree) != 0) return -1;
+        double serial_seconds = Bench_Layout(&serial_tree, 0);
+        if (serial_seconds == 0.0) return -1;
+        printf("%7s |  serial %9.3f\n", Document_Shape_Names[shapes[s]], serial_seconds * 1e3);
+
+        double one_thread_seconds = 0.0;
+        for (int threads=1; threads<=max_threads; threads = (threads * 2 > max_threads && threads < max_threads) ? max_threads : threads * 2)
+        {
+            struct UI_Tree ui_tree;
+            if (Bench_Load_Tree(src_buffer, src_length, &ui_tree) != 0) return -1;
+            double seconds = Bench_Layout(&ui_tree, threads);
+            if (seconds == 0.0) return -1;
+            uint32_t mismatches = Bench_Compare_Layout(&serial_tree, &ui_tree, threads);
+            Bench_Free_Tree(&ui_tree);
+            if (mismatches > 0) {
+                printf("[Benchmark] Error! %d threads: %u mismatches with the serial layout\n", threads, mismatches);
+                return -1;
+            }
+            if (threads == 1) one_thread_seconds = seconds;
+            printf("%7s | %7d %9.3f %8.2f\n", Document_Shape_Names[shapes[s]], threads, seconds * 1e3, one_thread_seconds / seconds);
+        }
+        Bench_Free_Tree(&serial_tree);
+        free(src_buffer);
+    }
+    return 0;
+}
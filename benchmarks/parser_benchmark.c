@@ -0,0 +1,186 @@
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// Count the allocations the parser makes (defined before the headers so their malloc calls are routed through here)
+static uint64_t bench_allocation_count = 0;
+static uint64_t bench_allocation_bytes = 0;
+static void* Bench_Malloc(size_t size)                { bench_allocation_count++; bench_allocation_bytes += size; return malloc(size); }
+static void* Bench_Realloc(void* pointer, size_t size) { bench_allocation_count++; bench_allocation_bytes += size; return realloc(pointer, size); }
+#define malloc(size) Bench_Malloc(size)
+#define realloc(pointer, size) Bench_Realloc(pointer, size)
+
+#include "parser.h"
+#include "document_generator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Parser throughput on synthetic documents. The tokeniser is timed on its own (tree builder skipped) and
+// together with the tree builder (a full NU_Parse_Source), the difference is the cost of building the tree.
+// Usage: parser_benchmark [wide|deep|text|attr|all] [node_count] [--write file.xml]
+//        (defaults to every shape at 1k, 10k, 100k and 1M nodes, --write saves the generated document and exits)
+
+#define BENCHMARK_MIN_RUNS 3
+#define BENCHMARK_MIN_SECONDS 0.25
+
+static double Bench_Seconds()
+{
+    #ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+    #else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+    #endif
+}
+
+static uint32_t Bench_Node_Count(struct UI_Tree* ui_tree)
+{
+    uint32_t node_count = 0;
+    for (int l=0; l<=ui_tree->deepest_layer; l++) {
+        node_count += ui_tree->tree_stack[l].size;
+    }
+    return node_count;
+}
+
+// Best time of the tokeniser alone
+static double Bench_Tokenise(char* src_buffer, uint32_t src_length, uint32_t* token_count_out)
+{
+    double best_seconds = 1e20;
+    double total_seconds = 0.0;
+    for (int run=0; run<BENCHMARK_MIN_RUNS || total_seconds < BENCHMARK_MIN_SECONDS; run++)
+    {
+        struct UI_Tree ui_tree;
+        struct NU_Parser parser;
+        NU_Parser_Init(&parser, &ui_tree, src_length);
+        parser.src_persistent = 1;
+        parser.tokenise_only = 1;
+        uint32_t consumed;
+
+        double start = Bench_Seconds();
+        NU_Tokenise(src_buffer, src_length, &parser, 1, &consumed);
+        double seconds = Bench_Seconds() - start;
+
+        best_seconds = MIN(best_seconds, seconds);
+        total_seconds += seconds;
+        *token_count_out = parser.token_count;
+        Vector_Free(&parser.carry);
+        NU_Free_UI_Tree_Memory(&ui_tree);
+    }
+    return best_seconds;
+}
+
+// Best time of the full parse (tokenise + tree build) and the allocations one parse makes
+static double Bench_Parse(char* src_buffer, uint32_t src_length, uint32_t* node_count_out, uint64_t* allocation_count_out, uint64_t* allocation_bytes_out)
+{
+    double best_seconds = 1e20;
+    double total_seconds = 0.0;
+    for (int run=0; run<BENCHMARK_MIN_RUNS || total_seconds < BENCHMARK_MIN_SECONDS; run++)
+    {
+        struct UI_Tree ui_tree;
+        bench_allocation_count = 0;
+        bench_allocation_bytes = 0;
+
+        double start = Bench_Seconds();
+        if (NU_Parse_Source(src_buffer, src_length, &ui_tree) != 0) return 0.0;
+        double seconds = Bench_Seconds() - start;
+
+        best_seconds = MIN(best_seconds, seconds);
+        total_seconds += seconds;
+        *node_count_out = Bench_Node_Count(&ui_tree);
+        *allocation_count_out = bench_allocation_count;
+        *allocation_bytes_out = bench_allocation_bytes;
+        NU_Free_UI_Tree_Memory(&ui_tree);
+    }
+    return best_seconds;
+}
+
+static int Bench_Document(enum Document_Shape shape, uint32_t requested_nodes)
+{
+    uint32_t src_length;
+    char* src_buffer = Generate_Document(shape, requested_nodes, &src_length);
+    double megabytes = (double) src_length / (1024.0 * 1024.0);
+
+    uint32_t token_count = 0;
+    uint32_t node_count = 0;
+    uint64_t allocation_count = 0;
+    uint64_t allocation_bytes = 0;
+    double tokenise_seconds = Bench_Tokenise(src_buffer, src_length, &token_count);
+    double parse_seconds = Bench_Parse(src_buffer, src_length, &node_count, &allocation_count, &allocation_bytes);
+    free(src_buffer);
+    if (parse_seconds == 0.0) {
+        printf("[Benchmark] Error! Generated %s document did not parse\n", Document_Shape_Names[shape]);
+        return -1;
+    }
+    double build_seconds = MAX(parse_seconds - tokenise_seconds, 0.0);
+
+    printf("%-5s %8u %8.2f | %8.1f %9.1f | %8.1f | %8.1f %9.1f | %6llu %9.2f\n",
+        Document_Shape_Names[shape], node_count, megabytes,
+        tokenise_seconds * 1e9 / node_count, megabytes / tokenise_seconds,
+        build_seconds * 1e9 / node_count,
+        parse_seconds * 1e9 / node_count, megabytes / parse_seconds,
+        (unsigned long long) allocation_count, (double) allocation_bytes / (1024.0 * 1024.0));
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int shape_filter = -1;
+    uint32_t node_count = 0;
+    char* write_filepath = NULL;
+    for (int a=1; a<argc; a++)
+    {
+        if (strcmp(argv[a], "--write") == 0 && a + 1 < argc) {
+            write_filepath = argv[++a];
+            continue;
+        }
+        int matched = 0;
+        for (int s=0; s<DOCUMENT_SHAPE_COUNT; s++) {
+            if (strcmp(argv[a], Document_Shape_Names[s]) == 0) {
+                shape_filter = s;
+                matched = 1;
+            }
+        }
+        if (!matched && strcmp(argv[a], "all") != 0) node_count = (uint32_t) strtoul(argv[a], NULL, 10);
+    }
+
+    // Save a generated document for other tools
+    if (write_filepath)
+    {
+        uint32_t src_length;
+        char* src_buffer = Generate_Document(shape_filter == -1 ? DOCUMENT_ATTR : shape_filter, node_count ? node_count : 100000, &src_length);
+        FILE* f = fopen(write_filepath, "wb");
+        if (!f) {
+            fprintf(stderr, "Cannot open file '%s': %s\n", write_filepath, strerror(errno));
+            return -1;
+        }
+        fwrite(src_buffer, 1, src_length, f);
+        fclose(f);
+        free(src_buffer);
+        return 0;
+    }
+
+    printf("Scan mode: %s\n", Scan_Mode_Name());
+    printf("                        |  tokenise          |  build   |  parse (tokenise + build) |  allocations\n");
+    printf("shape    nodes       MB |  ns/node      MB/s |  ns/node |  ns/node      MB/s |  count        MB\n");
+    uint32_t node_counts[4] = { 1000, 10000, 100000, 1000000 };
+    for (int s=0; s<DOCUMENT_SHAPE_COUNT; s++)
+    {
+        if (shape_filter != -1 && shape_filter != s) continue;
+        for (int n=0; n<4; n++)
+        {
+            if (node_count && n > 0) break;
+            if (Bench_Document(s, node_count ? node_count : node_counts[n]) != 0) return -1;
+        }
+    }
+    return 0;
+}
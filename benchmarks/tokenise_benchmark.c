@@ -0,0 +1,80 @@
+#define _CRT_SECURE_NO_WARNINGS 
+
+#include "parser.h"
+#include "resources.h"
+
+// Measures NU_Tokenise throughput (tokenise + tree build, single pass) for the SIMD and scalar scanning paths on the same input.
+// Usage: tokenise_benchmark [file.xml]  (without a file a ~8MB synthetic document is used)
+
+#define BENCHMARK_RUNS 10
+
+static char* Generate_Document(uint32_t target_size, uint32_t* length_out)
+{
+    const char* row = 
+        "    <rect dir=\"h\" grow=\"h\" alignH=\"center\">\n"
+        "        <!-- price cell -->\n"
+        "        <text width=\"120\" minWidth=\"40\">Bid 10234.50 quantity 250</text>\n"
+        "        <button height=\"24\">Buy</button>\n"
+        "        <rect/>\n"
+        "    </rect>\n";
+    uint32_t row_length = strlen(row);
+    char* src = malloc(target_size + row_length + 64);
+    uint32_t length = sprintf(src, "<window dir=\"v\">\n");
+    while (length < target_size) {
+        memcpy(src + length, row, row_length);
+        length += row_length;
+    }
+    length += sprintf(src + length, "</window>");
+    *length_out = length;
+    return src;
+}
+
+static double Benchmark_Tokenise(char* src_buffer, uint32_t src_length, uint32_t* node_count_out)
+{
+    double best_seconds = 1e20;
+    for (int run=0; run<BENCHMARK_RUNS; run++)
+    {
+        struct UI_Tree ui_tree;
+
+        clock_t start = clock();
+        if (NU_Parse_Source(src_buffer, src_length, &ui_tree) != 0) return 0.0;
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (seconds < best_seconds) best_seconds = seconds;
+
+        *node_count_out = 0;
+        for (int l=0; l<=ui_tree.deepest_layer; l++) {
+            *node_count_out += ui_tree.tree_stack[l].size;
+        }
+        NU_Free_UI_Tree_Memory(&ui_tree);
+    }
+    return best_seconds;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t src_length;
+    char* src_buffer;
+    if (argc > 1) {
+        int size;
+        src_buffer = (char*) Load_File(argv[1], &size);
+        if (!src_buffer) return -1;
+        src_length = (uint32_t) size;
+    } else {
+        src_buffer = Generate_Document(8 * 1024 * 1024, &src_length);
+    }
+    double megabytes = (double) src_length / (1024.0 * 1024.0);
+    printf("Input: %.2f MB\n", megabytes);
+
+    int modes[2] = { 0, 1 };
+    for (int m=0; m<2; m++)
+    {
+        Scan_SIMD_Enabled = modes[m];
+        uint32_t node_count = 0;
+        double seconds = Benchmark_Tokenise(src_buffer, src_length, &node_count);
+        if (seconds == 0.0) return -1;
+        printf("%-8s %10.1f MB/s  (%u nodes, best of %d runs)\n", Scan_Mode_Name(), megabytes / seconds, node_count, BENCHMARK_RUNS);
+    }
+
+    free(src_buffer);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+
+#include "parser.h"
+#include "tree_edit.h"
+#include "document_generator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Adding and removing a list of rows in the middle of a 100k node tree, one node at a time
+// (NU_Insert_Node / NU_Remove_Subtree) against the bulk calls (NU_Insert_Fragment / NU_Remove_Children).
+// Usage: tree_edit_benchmark [row_count]  (defaults to 100, 1k and 10k rows of 5 nodes)
+
+#define BENCHMARK_RUNS 5
+#define BENCHMARK_TREE_NODES 100000
+#define BENCHMARK_ROW_CELLS 4
+
+static double Bench_Seconds()
+{
+    #ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+    #else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+    #endif
+}
+
+// The list the rows go into -> a row of the generated tree half way through layer 1
+static uint32_t Bench_List_ID(struct UI_Tree* ui_tree)
+{
+    return (1 << 24) | (ui_tree->tree_stack[1].size / 2);
+}
+
+static char* Bench_Rows_Fragment(uint32_t row_count, uint32_t* length_out)
+{
+    const char* row = "<rect dir=\"h\"><button/><button/><button/><button/></rect>\n";
+    uint32_t row_length = strlen(row);
+    char* fragment = malloc(row_count * row_length);
+    for (uint32_t r=0; r<row_count; r++) {
+        memcpy(fragment + r * row_length, row, row_length);
+    }
+    *length_out = row_count * row_length;
+    return fragment;
+}
+
+// mode 0 -> insert node by node, 1 -> insert the fragment, 2 -> remove row by row, 3 -> remove the range
+static double Bench_Edit(char* src_buffer, uint32_t src_length, char* fragment, uint32_t fragment_length, uint32_t row_count, int mode)
+{
+    double best_seconds = 1e20;
+    for (int run=0; run<BENCHMARK_RUNS; run++)
+    {
+        struct UI_Tree ui_tree;
+        if (NU_Parse_Source(src_buffer, src_length, &ui_tree) != 0) return 0.0;
+        uint32_t list_ID = Bench_List_ID(&ui_tree);
+        struct Node* list = NU_Edit_Get_Node(&ui_tree, list_ID);
+        uint32_t first_row = list->child_count;
+        if (mode >= 2 && NU_Insert_Fragment(&ui_tree, list_ID, fragment, fragment_length) != 0) return 0.0;
+
+        double start = Bench_Seconds();
+        int result = 0;
+        if (mode == 0)
+        {
+            for (uint32_t r=0; r<row_count && result == 0; r++)
+            {
+                uint32_t row_ID, cell_ID;
+                result = NU_Insert_Node(&ui_tree, list_ID, UINT32_MAX, RECT, &row_ID);
+                for (int c=0; c<BENCHMARK_ROW_CELLS && result == 0; c++) {
+                    result = NU_Insert_Node(&ui_tree, row_ID, UINT32_MAX, BUTTON, &cell_ID);
+                }
+            }
+        }
+        else if (mode == 1) {
+            result = NU_Insert_Fragment(&ui_tree, list_ID, fragment, fragment_length);
+        }
+        else if (mode == 2)
+        {
+            for (uint32_t r=0; r<row_count && result == 0; r++) {
+                result = NU_Remove_Subtree(&ui_tree, (2 << 24) | (list->first_child_index + first_row));
+            }
+        }
+        else {
+            result = NU_Remove_Children(&ui_tree, list_ID, first_row, row_count);
+        }
+        double seconds = Bench_Seconds() - start;
+
+        if (result != 0 || list->child_count != first_row + (mode < 2 ? row_count : 0)) {
+            printf("[Benchmark] Error! Edit mode %d did not produce the expected tree\n", mode);
+            return 0.0;
+        }
+        best_seconds = MIN(best_seconds, seconds);
+        NU_Free_UI_Tree_Memory(&ui_tree);
+    }
+    return best_seconds;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t src_length;
+    char* src_buffer = Generate_Document(DOCUMENT_WIDE, BENCHMARK_TREE_NODES, &src_length);
+    uint32_t row_counts[3] = { 100, 1000, 10000 };
+    int count_total = 3;
+    if (argc > 1) {
+        row_counts[0] = (uint32_t) strtoul(argv[1], NULL, 10);
+        count_total = 1;
+    }
+
+    printf("%u node tree, rows of %d nodes, microseconds per row (best of %d runs)\n", BENCHMARK_TREE_NODES, 1 + BENCHMARK_ROW_CELLS, BENCHMARK_RUNS);
+    printf("   rows |  insert: node by node  fragment |  remove: row by row     range\n");
+    for (int n=0; n<count_total; n++)
+    {
+        uint32_t row_count = row_counts[n];
+        uint32_t fragment_length;
+        char* fragment = Bench_Rows_Fragment(row_count, &fragment_length);
+        double seconds[4];
+        for (int mode=0; mode<4; mode++)
+        {
+            seconds[mode] = Bench_Edit(src_buffer, src_length, fragment, fragment_length, row_count, mode);
+            if (seconds[mode] == 0.0) return -1;
+        }
+        printf("%7u |  %20.3f %9.3f |  %17.3f %9.3f\n", row_count,
+            seconds[0] * 1e6 / row_count, seconds[1] * 1e6 / row_count,
+            seconds[2] * 1e6 / row_count, seconds[3] * 1e6 / row_count);
+        free(fragment);
+    }
+    free(src_buffer);
+    return 0;
+}
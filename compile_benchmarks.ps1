@@ -0,0 +1,52 @@
+$headersInclude = "headers"
+$sdlLib = "lib\SDL3\lib" 
+$sdlInclude = "lib\SDL3\include"
+$glewInclude = "lib\glew\include"
+$glewLib = "lib\glew\lib"
+$nanovgInclude = "lib\nanoVG"
+$freetypeInclude = "lib\freetype\include"
+
+# Tokeniser throughput (SIMD vs scalar scanning)
+clang -std=c99 -O2 benchmarks\tokenise_benchmark.c `
+-I"$headersInclude" `
+-I"$glewInclude" `
+-I"$sdlInclude" `
+-I"$nanovgInclude" `
+-L"$glewLib" `
+-L"$sdlLib" `
+-lglew32 -lSDL3 -lopengl32 `
+-o build/tokenise_benchmark.exe -Wno-deprecated-declarations
+
+# Parser throughput on synthetic documents (tokenise / tree build / allocations)
+clang -std=c99 -O2 benchmarks\parser_benchmark.c `
+-I"$headersInclude" `
+-I"$glewInclude" `
+-I"$sdlInclude" `
+-I"$nanovgInclude" `
+-L"$glewLib" `
+-L"$sdlLib" `
+-lglew32 -lSDL3 -lopengl32 `
+-o build/parser_benchmark.exe -Wno-deprecated-declarations
+
+# Tree editing, node by node against the bulk fragment insert / range remove
+clang -std=c99 -O2 benchmarks\tree_edit_benchmark.c `
+-I"$headersInclude" `
+-I"$glewInclude" `
+-I"$sdlInclude" `
+-I"$nanovgInclude" `
+-L"$glewLib" `
+-L"$sdlLib" `
+-lglew32 -lSDL3 -lopengl32 `
+-o build/tree_edit_benchmark.exe -Wno-deprecated-declarations
+
+# Full layout per layout pool thread count (nanovg is stubbed, no window or font is needed)
+clang -std=c99 -O2 benchmarks\layout_benchmark.c `
+-I"$headersInclude" `
+-I"$glewInclude" `
+-I"$sdlInclude" `
+-I"$nanovgInclude" `
+-I"$freetypeInclude" `
+-L"$glewLib" `
+-L"$sdlLib" `
+-lglew32 -lSDL3 -lopengl32 `
+-o build/layout_benchmark.exe -Wno-deprecated-declarations
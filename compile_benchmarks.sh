@@ -0,0 +1,45 @@
+#!/bin/sh
+# Linux build of the benchmarks (see compile_benchmarks.ps1). Only the parser is linked, so SDL and GL are header only here
+# (except for the layout benchmark: its pool runs on SDL threads).
+headersInclude="headers"
+sdlInclude="lib/SDL3/include"
+glewInclude="lib/glew/include"
+nanovgInclude="lib/nanoVG"
+freetypeInclude="lib/freetype/include"
+flags="-std=c99 -D_DEFAULT_SOURCE -O2 -ffunction-sections -fdata-sections -Wl,--gc-sections -Wno-deprecated-declarations"
+
+mkdir -p build
+
+# Tokeniser throughput (SIMD vs scalar scanning)
+cc $flags benchmarks/tokenise_benchmark.c \
+-I"$headersInclude" \
+-I"$glewInclude" \
+-I"$sdlInclude" \
+-I"$nanovgInclude" \
+-o build/tokenise_benchmark -lm || exit 1
+
+# Parser throughput on synthetic documents (tokenise / tree build / allocations)
+cc $flags benchmarks/parser_benchmark.c \
+-I"$headersInclude" \
+-I"$glewInclude" \
+-I"$sdlInclude" \
+-I"$nanovgInclude" \
+-o build/parser_benchmark -lm || exit 1
+
+# Tree editing, node by node against the bulk fragment insert / range remove
+cc $flags benchmarks/tree_edit_benchmark.c \
+-I"$headersInclude" \
+-I"$glewInclude" \
+-I"$sdlInclude" \
+-I"$nanovgInclude" \
+-o build/tree_edit_benchmark -lm || exit 1
+
+# Full layout per layout pool thread count (nanovg is stubbed, no window or font is needed). lib/SDL3 only ships
+# the Windows libraries, so this one links the system's SDL3, GLEW and GL and is skipped when they are missing.
+cc $flags benchmarks/layout_benchmark.c \
+-I"$headersInclude" \
+-I"$glewInclude" \
+-I"$sdlInclude" \
+-I"$nanovgInclude" \
+-I"$freetypeInclude" \
+-o build/layout_benchmark -lSDL3 -lGLEW -lGL -lm || echo "Skipped the layout benchmark (needs the system's SDL3, GLEW and GL)"
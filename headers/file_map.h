@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// A read only view of a whole file. The bytes are NOT null terminated.
+struct File_Map
+{
+    char* data;
+    uint32_t length;
+    uint8_t is_mapped; // 1 == memory mapped, 0 == read into a malloc'd buffer (fallback)
+};
+
+static int File_Map_Read_Fallback(const char* filepath, struct File_Map* map)
+{
+    FILE* f = fopen(filepath, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open file '%s': %s\n", filepath, strerror(errno));
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size_long = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (file_size_long > UINT32_MAX) {
+        printf("%s", "Src file is too large! It must be < 4 294 967 295 Bytes");
+        fclose(f);
+        return -1;
+    }
+    map->data = malloc(file_size_long + 1);
+    map->length = fread(map->data, 1, file_size_long, f);
+    map->is_mapped = 0;
+    fclose(f);
+    return 0;
+}
+
+// writable == 1 -> the view is copy on write: writes stay private to the process and never reach the file
+static int File_Map_Open_View(const char* filepath, struct File_Map* map, int writable)
+{
+    map->data = NULL;
+    map->length = 0;
+    map->is_mapped = 0;
+
+    #ifdef _WIN32
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return File_Map_Read_Fallback(filepath, map);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || size.QuadPart > UINT32_MAX) {
+        CloseHandle(file);
+        return File_Map_Read_Fallback(filepath, map);
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    void* view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping) CloseHandle(mapping); // the view keeps the mapping alive
+    CloseHandle(file);
+    if (!view) return File_Map_Read_Fallback(filepath, map);
+    map->length = (uint32_t) size.QuadPart;
+    #else
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return File_Map_Read_Fallback(filepath, map);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > UINT32_MAX) {
+        close(fd);
+        return File_Map_Read_Fallback(filepath, map);
+    }
+    void* view = mmap(NULL, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid after the descriptor is closed
+    if (view == MAP_FAILED) return File_Map_Read_Fallback(filepath, map);
+    map->length = (uint32_t) st.st_size;
+    #endif
+
+    map->data = (char*) view;
+    map->is_mapped = 1;
+    return 0;
+}
+
+int File_Map_Open(const char* filepath, struct File_Map* map)
+{
+    return File_Map_Open_View(filepath, map, 0);
+}
+
+// A view that can be written like a malloc'd copy of the file (pages are only copied once they are written)
+int File_Map_Open_Private(const char* filepath, struct File_Map* map)
+{
+    return File_Map_Open_View(filepath, map, 1);
+}
+
+void File_Map_Close(struct File_Map* map)
+{
+    if (map->data == NULL) return;
+    if (map->is_mapped) {
+        #ifdef _WIN32
+        UnmapViewOfFile(map->data);
+        #else
+        munmap(map->data, map->length);
+        #endif
+    } else {
+        free(map->data);
+    }
+    map->data = NULL;
+    map->length = 0;
+}
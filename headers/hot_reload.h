@@ -0,0 +1,765 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "parser.h"
+#include "tree_edit.h"
+#include "file_map.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+// Hot reload: watches the XML source, re-parses it when it changes and patches the live UI tree in place.
+// Windows, GL contexts, nanovg contexts and font registries stay alive across reloads.
+// A save is diffed against the previous source first: only the smallest element around the changed bytes is
+// re-parsed and compared with its live node. The whole file is re-parsed when that can't be narrowed down.
+struct NU_Hot_Reload
+{
+    char* filepath;
+    struct UI_Tree scratch_tree; // the re-parsed tree or element, its memory is reused between reloads
+    uint8_t scratch_ready;
+    struct Vector source; // the source the live tree was last patched from
+    #ifdef __linux__
+    int inotify_fd;
+    int watch_fd;
+    const char* filename; // filepath without its directory (inotify watches the directory so editors that replace the file are seen)
+    #else
+    time_t last_modified;
+    #endif
+};
+
+// Parses [start, end) of the src into the scratch tree, reusing the memory of the previous reload.
+// Without range the src is a whole document. A range must be a list of complete elements without loose text,
+// they land under a stand in root (scratch node 0).
+static int NU_Hot_Reload_Parse(struct NU_Hot_Reload* hot_reload, struct File_Map* src_file, uint32_t start, uint32_t end, uint8_t range)
+{
+    struct UI_Tree* scratch_tree = &hot_reload->scratch_tree;
+    struct NU_Parser parser;
+    if (!hot_reload->scratch_ready)
+    {
+        NU_Parser_Init(&parser, scratch_tree, end - start);
+        hot_reload->scratch_ready = 1;
+    }
+    else
+    {
+        NU_Reset_UI_Tree_Memory(scratch_tree, end - start);
+        NU_Parser_Reset(&parser, scratch_tree);
+    }
+    scratch_tree->src_file = *src_file; // borrowed for the duration of the patch
+    parser.src_persistent = 1;
+    parser.src_offset = start;
+    if (range)
+    {
+        NU_Parser_Open_Node(&parser, WINDOW);
+        parser.grammar = GRAMMAR_CONTENT;
+    }
+    uint32_t consumed;
+    if (NU_Tokenise(src_file->data + start, end - start, &parser, 1, &consumed) != 0) parser.grammar = GRAMMAR_ERROR;
+    if (!range) return NU_Parser_Finish(&parser);
+
+    Vector_Free(&parser.carry);
+    struct Node_Cold* stand_in_root_cold = Vector_Get(&scratch_tree->cold_stack[0], 0);
+    if (parser.grammar == GRAMMAR_ERROR || parser.current_layer != 0 || parser.ctx != 0 || parser.text_char_count > 0 || stand_in_root_cold->text_ref_index != -1) {
+        return -1; // Failure
+    }
+    return 0; // Success
+}
+
+// Length of the common prefix (backwards -> suffix) of a and b, compared a block at a time
+#define NU_DIFF_BLOCK 256
+static uint32_t NU_Common_Prefix(const char* a, const char* b, uint32_t length)
+{
+    uint32_t i = 0;
+    while (i + NU_DIFF_BLOCK <= length && memcmp(a + i, b + i, NU_DIFF_BLOCK) == 0) i += NU_DIFF_BLOCK;
+    while (i < length && a[i] == b[i]) i++;
+    return i;
+}
+
+static uint32_t NU_Common_Suffix(const char* a_end, const char* b_end, uint32_t length)
+{
+    uint32_t i = 0;
+    while (i + NU_DIFF_BLOCK <= length && memcmp(a_end - i - NU_DIFF_BLOCK, b_end - i - NU_DIFF_BLOCK, NU_DIFF_BLOCK) == 0) i += NU_DIFF_BLOCK;
+    while (i < length && a_end[-1 - (int64_t) i] == b_end[-1 - (int64_t) i]) i++;
+    return i;
+}
+
+// A change that only inserts (or only removes) the length bytes at src + start can sit anywhere along a run of
+// repeated text. Returns the closest start to the left where those bytes begin with a tag, so the change covers
+// whole elements (start if there is none).
+static uint32_t NU_Align_Change(char* src, uint32_t start, uint32_t length)
+{
+    if (length == 0 || src[start] == '<') return start;
+    for (uint32_t i=start; i>0 && src[i-1] == src[i-1+length]; )
+    {
+        i--;
+        if (src[i] == '<') return i;
+    }
+    return start;
+}
+
+// Finds the '>' that ends the tag opened at i, skipping over property values. Returns length if there is none.
+static uint32_t NU_Skip_Tag(char* src, uint32_t length, uint32_t i)
+{
+    uint32_t j = i + 1;
+    while (1)
+    {
+        j = Scan_Until(src, j, length, SCAN_CLOSE);
+        if (j == length || src[j] == '>') return j;
+        j = Scan_Until(src, j + 1, length, SCAN_QUOTE);
+        if (j == length) return length;
+        j+=1;
+    }
+}
+
+// Skips a comment opened at i. Returns the index after "-->" or length if there is none.
+static uint32_t NU_Skip_Comment(char* src, uint32_t length, uint32_t i)
+{
+    i+=4;
+    while (1)
+    {
+        i = Scan_Until(src, i, length, SCAN_COMMENT);
+        if (i + 2 >= length) return length;
+        if (src[i+1] == '-' && src[i+2] == '>') return i + 3;
+        i+=1;
+    }
+}
+
+static int NU_Is_Comment(char* src, uint32_t length, uint32_t i)
+{
+    return i + 3 < length && src[i+1] == '!' && src[i+2] == '-' && src[i+3] == '-';
+}
+
+// Where a change sits in the source: the innermost element around it and whether the change stays inside the
+// element's start tag or inside its content. In its content, the run of the element's children between the
+// unchanged ones (the run's bytes go from the end of the last child before the change to the start of the first
+// child after it).
+struct NU_Changed_Element
+{
+    int depth;
+    uint16_t path[MAX_TREE_DEPTH]; // child position at each depth, path[0] is the root
+    uint32_t start, tag_end, end;  // end is 0 if the scan stopped before the element's end
+    uint8_t in_tag;
+    uint8_t in_content;
+    uint32_t run_start, run_end;
+    uint32_t run_first, run_count;
+};
+
+// Finds the innermost element of the src that starts before change_start and ends after change_end, the changed
+// bytes [change_start, change_end). The scan stops as soon as the element is known unless need_end is set.
+// Returns -1 if there is none. Only structure is scanned (tags, quoted values and comments, see
+// NU_Prescan_Root_Children), the src is a source that parsed.
+static int NU_Find_Changed_Element(char* src, uint32_t length, uint32_t change_start, uint32_t change_end, uint8_t need_end, struct NU_Changed_Element* changed)
+{
+    // Per open element: where it and its content start, the children that end before the change and the first
+    // child that starts after it (child_counts[0] counts the top level elements)
+    uint32_t starts[MAX_TREE_DEPTH];
+    uint32_t content_starts[MAX_TREE_DEPTH];
+    uint32_t before_ends[MAX_TREE_DEPTH];
+    uint32_t before_counts[MAX_TREE_DEPTH];
+    uint32_t after_starts[MAX_TREE_DEPTH];
+    uint32_t after_positions[MAX_TREE_DEPTH];
+    uint32_t child_counts[MAX_TREE_DEPTH + 1];
+    int depth = 0;
+    int candidates = -1; // once the scan reaches the change: the open elements that start before it
+    child_counts[0] = 0;
+    uint32_t i = 0;
+    while (1)
+    {
+        i = Scan_Until(src, i, length, SCAN_OPEN);
+        if (i == length) return -1;
+        if (candidates == -1 && i >= change_start) candidates = depth;
+        if (candidates == 0) return -1;
+        if (NU_Is_Comment(src, length, i))
+        {
+            i = NU_Skip_Comment(src, length, i);
+            continue;
+        }
+        uint32_t j = NU_Skip_Tag(src, length, i);
+        if (j == length) return -1;
+        uint8_t end_tag = src[i+1] == '/';
+        uint8_t self_closing = !end_tag && src[j-1] == '/';
+
+        // Opening tag -> one more open element (a self closing one closes again straight away)
+        if (!end_tag)
+        {
+            if (depth == MAX_TREE_DEPTH) return -1;
+            uint32_t position = child_counts[depth]++;
+            if (depth > 0 && i >= change_end && after_starts[depth-1] == UINT32_MAX)
+            {
+                after_starts[depth-1] = i;
+                after_positions[depth-1] = position;
+
+                // A child after the change -> the candidate around it ends after the change too
+                if (depth - 1 < candidates && !need_end)
+                {
+                    changed->depth = depth - 1;
+                    changed->start = starts[depth-1];
+                    changed->tag_end = content_starts[depth-1];
+                    changed->end = 0;
+                    changed->in_tag = 0;
+                    changed->in_content = change_start >= content_starts[depth-1];
+                    changed->run_start = before_ends[depth-1];
+                    changed->run_end = i;
+                    changed->run_first = before_counts[depth-1];
+                    changed->run_count = position - before_counts[depth-1];
+                    return 0; // Success
+                }
+            }
+            changed->path[depth] = position;
+            starts[depth] = i;
+            content_starts[depth] = j + 1;
+            before_ends[depth] = j + 1;
+            before_counts[depth] = 0;
+            after_starts[depth] = UINT32_MAX;
+            child_counts[depth+1] = 0;
+            depth++;
+            if (candidates == -1 && j + 1 > change_start) candidates = depth; // the change starts inside this tag
+
+            // The change stays inside this start tag
+            if (depth == candidates && change_end < j + 1 && !need_end)
+            {
+                changed->depth = depth - 1;
+                changed->start = i;
+                changed->tag_end = j + 1;
+                changed->end = 0;
+                changed->in_tag = 1;
+                changed->in_content = 0;
+                return 0; // Success
+            }
+        }
+        if (!end_tag && !self_closing)
+        {
+            i = j + 1;
+            continue;
+        }
+
+        // Element ends -> done if it is a candidate that ends after the change
+        if (candidates == -1 && j + 1 > change_start) candidates = depth; // the change starts inside this end tag
+        depth--;
+        if (depth < 0) return -1;
+        uint32_t content_end = end_tag ? i : j + 1;
+        if (depth < candidates && change_end < j + 1)
+        {
+            changed->depth = depth;
+            changed->start = starts[depth];
+            changed->tag_end = content_starts[depth];
+            changed->end = j + 1;
+            changed->in_tag = change_end < content_starts[depth];
+            changed->in_content = change_start >= content_starts[depth] && change_end <= content_end;
+            changed->run_start = before_ends[depth];
+            changed->run_first = before_counts[depth];
+            changed->run_end = (after_starts[depth] == UINT32_MAX) ? content_end : after_starts[depth];
+            changed->run_count = ((after_starts[depth] == UINT32_MAX) ? child_counts[depth+1] : after_positions[depth]) - changed->run_first;
+            return 0; // Success
+        }
+        if (depth < candidates) candidates = depth;
+        if (depth > 0 && j + 1 <= change_start)
+        {
+            before_ends[depth-1] = j + 1;
+            before_counts[depth-1] = changed->path[depth] + 1;
+        }
+        i = j + 1;
+    }
+}
+
+// 1 if [start, end) of the src has text outside its elements (text that belongs to the element around it)
+static int NU_Has_Loose_Text(char* src, uint32_t start, uint32_t end)
+{
+    int depth = 0;
+    uint32_t i = start;
+    while (i < end)
+    {
+        if (depth == 0)
+        {
+            while (i < end && (src[i] == ' ' || src[i] == '\t' || src[i] == '\n' || src[i] == '\r')) i++;
+            if (i == end) return 0;
+            if (src[i] != '<') return 1;
+        }
+        else
+        {
+            i = Scan_Until(src, i, end, SCAN_OPEN);
+            if (i == end) return 0;
+        }
+        if (NU_Is_Comment(src, end, i))
+        {
+            i = NU_Skip_Comment(src, end, i);
+            continue;
+        }
+        uint32_t j = NU_Skip_Tag(src, end, i);
+        if (j == end) return 1;
+        if (src[i+1] == '/') depth--;
+        else if (src[j-1] != '/') depth++;
+        i = j + 1;
+    }
+    return 0;
+}
+
+static int NU_Node_Ids_Equal(struct UI_Tree* a_tree, struct Node_Cold* a_cold, struct UI_Tree* b_tree, struct Node_Cold* b_cold)
+{
+    if (a_cold->id_index == -1 || b_cold->id_index == -1) return a_cold->id_index == b_cold->id_index;
+    return strcmp((char*) a_tree->id_chars.data + a_cold->id_index, (char*) b_tree->id_chars.data + b_cold->id_index) == 0;
+}
+
+// Compares everything the XML sets (layout results and window handles are ignored, colours are not set from XML yet)
+static int NU_Node_Properties_Equal(struct Node* a, struct Node_Cold* a_cold, struct Node* b, struct Node_Cold* b_cold)
+{
+    return a->preferred_width == b->preferred_width && a->preferred_height == b->preferred_height &&
+           a->min_width == b->min_width && a->max_width == b->max_width &&
+           a->min_height == b->min_height && a->max_height == b->max_height &&
+           a->gap == b->gap &&
+           a->pad_top == b->pad_top && a->pad_bottom == b->pad_bottom && a->pad_left == b->pad_left && a->pad_right == b->pad_right &&
+           a->border_top == b->border_top && a->border_bottom == b->border_bottom && a->border_left == b->border_left && a->border_right == b->border_right &&
+           a_cold->border_radius_tl == b_cold->border_radius_tl && a_cold->border_radius_tr == b_cold->border_radius_tr &&
+           a_cold->border_radius_bl == b_cold->border_radius_bl && a_cold->border_radius_br == b_cold->border_radius_br &&
+           a->layout_flags == b->layout_flags &&
+           a->width_unit == b->width_unit && a->height_unit == b->height_unit &&
+           a->horizontal_alignment == b->horizontal_alignment &&
+           a->vertical_alignment == b->vertical_alignment;
+}
+
+// Copies a node's properties from the new tree over a live node, keeping the live node's place in the tree
+// (indices, slack, text and id), its window, nanovg context, handle and layout
+static void NU_Patch_Node(struct Node* node, struct Node_Cold* cold, struct Node* new_node, struct Node_Cold* new_cold)
+{
+    struct Node live = *node;
+    struct Node_Cold live_cold = *cold;
+    *node = *new_node;
+    *cold = *new_cold;
+    cold->window = live_cold.window;
+    cold->vg = live_cold.vg;
+    cold->ID = live_cold.ID;
+    cold->text_ref_index = live_cold.text_ref_index;
+    cold->handle_index = live_cold.handle_index;
+    cold->id_index = live_cold.id_index;
+    cold->child_capacity = live_cold.child_capacity;
+    node->parent_index = live.parent_index;
+    node->first_child_index = live.first_child_index;
+    node->child_count = live.child_count;
+    node->dirty = live.dirty;
+    node->x = live.x;
+    node->y = live.y;
+    node->width = live.width;
+    node->height = live.height;
+    node->fit_width = live.fit_width;
+    node->fit_height = live.fit_height;
+}
+
+// Gives a live node the new node's text. Returns 1 if it changed.
+static int NU_Patch_Node_Text(struct UI_Tree* ui_tree, struct Node_Cold* cold, struct UI_Tree* new_tree, struct Node_Cold* new_cold)
+{
+    if (new_cold->text_ref_index == -1)
+    {
+        if (cold->text_ref_index == -1) return 0;
+        NU_Remove_Text_Ref(ui_tree, cold->text_ref_index);
+        cold->text_ref_index = -1;
+        return 1;
+    }
+    struct Text_Ref* new_ref = Vector_Get(&new_tree->text_arena.text_refs, new_cold->text_ref_index);
+    char* new_text = NU_Text_Ref_Chars(new_tree, new_ref);
+    if (cold->text_ref_index != -1)
+    {
+        struct Text_Ref* text_ref = Vector_Get(&ui_tree->text_arena.text_refs, cold->text_ref_index);
+        if (text_ref->char_count == new_ref->char_count && memcmp(NU_Text_Ref_Chars(ui_tree, text_ref), new_text, new_ref->char_count) == 0) return 0;
+    }
+    NU_Set_Text(ui_tree, cold->ID, new_text, new_ref->char_count); // changed text is overwritten in place when it fits
+    return 1;
+}
+
+// 1 if a node among count children of the node (from child first on) or below them is a window
+static int NU_Children_Have_Window(struct UI_Tree* tree, uint32_t node_ID, uint32_t first, uint32_t count)
+{
+    uint32_t layer = node_ID >> 24;
+    struct Node* node = Vector_Get(&tree->tree_stack[layer], node_ID & 0x00FFFFFF);
+    for (uint32_t i=first; i<first+count; i++)
+    {
+        uint32_t child_index = node->first_child_index + i;
+        struct Node* child = Vector_Get(&tree->tree_stack[layer+1], child_index);
+        if (child->tag == WINDOW || NU_Children_Have_Window(tree, ((layer+1) << 24) | child_index, 0, child->child_count)) return 1;
+    }
+    return 0;
+}
+
+static uint8_t NU_Child_Tag(struct UI_Tree* tree, uint32_t node_ID, uint32_t i)
+{
+    struct Node* node = Vector_Get(&tree->tree_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    return ((struct Node*) Vector_Get(&tree->tree_stack[(node_ID >> 24) + 1], node->first_child_index + i))->tag;
+}
+
+static uint32_t NU_Child_ID(struct UI_Tree* tree, uint32_t node_ID, uint32_t i)
+{
+    struct Node* node = Vector_Get(&tree->tree_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    return (((node_ID >> 24) + 1) << 24) | (node->first_child_index + i);
+}
+
+static int NU_Patch_Subtree(struct UI_Tree* ui_tree, uint32_t node_ID, struct UI_Tree* new_tree, uint32_t new_ID, uint32_t* patched);
+
+// Patches count live children of the node (from child first on) from new_count children of the new node (from
+// child new_first on). Children are paired in order (only the live children, never the slack behind them, so a
+// tree edited through tree_edit.h still patches in place). Where the tags differ, the run of children between the
+// matching front and back is removed and the new run inserted (handles into it go stale, the rest keep theirs).
+// Returns -1 if windows would come and go.
+static int NU_Patch_Children(struct UI_Tree* ui_tree, uint32_t node_ID, uint32_t first, uint32_t count, struct UI_Tree* new_tree, uint32_t new_ID, uint32_t new_first, uint32_t new_count, uint32_t* patched)
+{
+    // Children with matching tags at the front and back
+    uint32_t front = 0;
+    uint32_t back = 0;
+    while (front < MIN(count, new_count) && NU_Child_Tag(ui_tree, node_ID, first + front) == NU_Child_Tag(new_tree, new_ID, new_first + front)) front++;
+    while (back < MIN(count, new_count) - front && NU_Child_Tag(ui_tree, node_ID, first + count - 1 - back) == NU_Child_Tag(new_tree, new_ID, new_first + new_count - 1 - back)) back++;
+
+    // Children in between were added, removed or changed tag -> replace them
+    if (front + back < MAX(count, new_count))
+    {
+        uint32_t removed = count - front - back;
+        uint32_t inserted = new_count - front - back;
+        if (NU_Children_Have_Window(ui_tree, node_ID, first + front, removed) || NU_Children_Have_Window(new_tree, new_ID, new_first + front, inserted)) return -1;
+        if (NU_Remove_Children(ui_tree, node_ID, first + front, removed) != 0) return -1;
+        if (NU_Insert_Tree_Children(ui_tree, node_ID, first + front, new_tree, new_ID, new_first + front, inserted) != 0) return -1;
+        *patched += removed + inserted;
+    }
+
+    // Layers below only move by index when a child segment grows, so the children are looked up again each time
+    for (uint32_t i=0; i<new_count; i++)
+    {
+        if (i >= front && i < new_count - back) continue;
+        if (NU_Patch_Subtree(ui_tree, NU_Child_ID(ui_tree, node_ID, first + i), new_tree, NU_Child_ID(new_tree, new_ID, new_first + i), patched) != 0) return -1;
+    }
+    return 0; // Success
+}
+
+// Gives a live node the new node's id and properties. Returns 1 if they changed.
+static int NU_Patch_Node_Attributes(struct UI_Tree* ui_tree, struct Node* node, struct Node_Cold* cold, struct UI_Tree* new_tree, struct Node* new_node, struct Node_Cold* new_cold)
+{
+    int changed = 0;
+    if (!NU_Node_Ids_Equal(ui_tree, cold, new_tree, new_cold))
+    {
+        if (new_cold->id_index == -1) {
+            NU_Id_Table_Remove(ui_tree, cold);
+        } else {
+            const char* id = (char*) new_tree->id_chars.data + new_cold->id_index;
+            NU_Assign_Node_Id(ui_tree, cold, id, strlen(id));
+        }
+        changed = 1;
+    }
+    if (!NU_Node_Properties_Equal(node, cold, new_node, new_cold))
+    {
+        NU_Patch_Node(node, cold, new_node, new_cold);
+        changed = 1;
+    }
+    return changed;
+}
+
+// Patches a live node and everything below it from the node at the same place in the new tree.
+// Only changed nodes are marked dirty. Returns -1 if the tags differ or windows would come and go.
+static int NU_Patch_Subtree(struct UI_Tree* ui_tree, uint32_t node_ID, struct UI_Tree* new_tree, uint32_t new_ID, uint32_t* patched)
+{
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    struct Node* new_node = Vector_Get(&new_tree->tree_stack[new_ID >> 24], new_ID & 0x00FFFFFF);
+    struct Node_Cold* new_cold = Vector_Get(&new_tree->cold_stack[new_ID >> 24], new_ID & 0x00FFFFFF);
+    if (node->tag != new_node->tag) return -1;
+    int changed = NU_Patch_Node_Attributes(ui_tree, node, cold, new_tree, new_node, new_cold);
+    changed |= NU_Patch_Node_Text(ui_tree, cold, new_tree, new_cold);
+    if (changed)
+    {
+        NU_Mark_Node_Dirty(ui_tree, node_ID);
+        *patched += 1;
+    }
+    return NU_Patch_Children(ui_tree, node_ID, 0, node->child_count, new_tree, new_ID, 0, new_node->child_count, patched);
+}
+
+// Replaces the live layers with the new tree's and hands the existing windows to the window nodes in order (other
+// nodes pick up their window again in NU_Clear_Node_Sizes). Handles go stale. Returns the number of nodes.
+static uint32_t NU_Replace_Layers(struct UI_Tree* ui_tree, struct UI_Tree* new_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    int deepest_layer = MAX(ui_tree->deepest_layer, new_tree->deepest_layer);
+    NU_Reserve_Layers(ui_tree, deepest_layer + 2); // both trees get every layer the other one uses
+    NU_Reserve_Layers(new_tree, deepest_layer + 2);
+    NU_Invalidate_Node_Handles(ui_tree);
+    struct Vector old_windows;
+    NU_Collect_Windows(ui_tree, &old_windows);
+    uint32_t window_count = 0;
+    uint32_t patched = 0;
+    for (int l=0; l<=deepest_layer; l++)
+    {
+        struct Vector* layer = &ui_tree->tree_stack[l];
+        struct Vector* new_layer = &new_tree->tree_stack[l];
+        struct Vector* cold_layer = &ui_tree->cold_stack[l];
+        Vector_Resize(layer, new_layer->size);
+        Vector_Resize(cold_layer, new_layer->size);
+        memcpy(layer->data, new_layer->data, new_layer->size * sizeof(struct Node));
+        memcpy(cold_layer->data, new_tree->cold_stack[l].data, new_layer->size * sizeof(struct Node_Cold));
+        ui_tree->free_slots[l].size = 0;
+        patched += new_layer->size;
+        for (uint32_t n=0; n<layer->size; n++)
+        {
+            struct Node* node = Vector_Get(layer, n);
+            struct Node_Cold* cold = Vector_Get(cold_layer, n);
+            cold->window = NULL;
+            cold->vg = NULL;
+            cold->handle_index = -1;
+            if (node->tag == WINDOW && window_count < old_windows.size) {
+                struct Node_Cold* old_window = Vector_Get(&old_windows, window_count++);
+                cold->window = old_window->window;
+                cold->vg = old_window->vg;
+            }
+        }
+    }
+    for (uint32_t i=window_count; i<old_windows.size; i++) {
+        struct Node_Cold* old_window = Vector_Get(&old_windows, i);
+        NU_Close_Window(ui_tree, old_window->window, windows, gl_contexts, nano_vg_contexts);
+    }
+    Vector_Free(&old_windows);
+    ui_tree->deepest_layer = new_tree->deepest_layer;
+
+    // The text refs are renumbered with the nodes -> rebuild the arena
+    struct Text_Arena* text_arena = &ui_tree->text_arena;
+    struct Vector* new_text_refs = &new_tree->text_arena.text_refs;
+    NU_Clear_Text_Free_Lists(text_arena);
+    text_arena->char_buffer.size = 0;
+    text_arena->rows.size = 0;
+    text_arena->free_rows = 0;
+    Vector_Resize(&text_arena->text_refs, new_text_refs->size);
+    for (uint32_t i=0; i<new_text_refs->size; i++)
+    {
+        char null_terminator = '\0';
+        struct Text_Ref* new_ref = Vector_Get(new_text_refs, i);
+        struct Text_Ref* text_ref = Vector_Get(&text_arena->text_refs, i);
+        text_ref->node_ID = new_ref->node_ID;
+        text_ref->buffer_index = text_arena->char_buffer.size;
+        text_ref->char_count = new_ref->char_count;
+        text_ref->char_capacity = new_ref->char_count;
+        text_ref->in_source = 0;
+        text_ref->measured_font = -1;
+        text_ref->row_count = 0;
+        text_ref->row_capacity = 0;
+        Vector_Push_Range(&text_arena->char_buffer, NU_Text_Ref_Chars(new_tree, new_ref), new_ref->char_count);
+        Vector_Push(&text_arena->char_buffer, &null_terminator);
+    }
+
+    // The nodes now point into the new tree's id chars
+    Vector_Resize(&ui_tree->id_chars, new_tree->id_chars.size);
+    memcpy(ui_tree->id_chars.data, new_tree->id_chars.data, new_tree->id_chars.size);
+    NU_Rebuild_Id_Table(ui_tree);
+    NU_Touch_Tree(ui_tree);
+    NU_Mark_Tree_Dirty(ui_tree);
+    return patched;
+}
+
+// Diffs the new tree against the live tree and patches only what changed. The layers are only replaced
+// when the root changes tag or windows come and go. Returns the number of nodes that changed.
+int NU_Patch_UI_Tree(struct UI_Tree* ui_tree, struct UI_Tree* new_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    NU_Detach_Source_Text(ui_tree);
+    uint32_t patched = 0;
+    if (NU_Patch_Subtree(ui_tree, 0, new_tree, 0, &patched) == 0) return (int) patched;
+    return (int) NU_Replace_Layers(ui_tree, new_tree, windows, gl_contexts, nano_vg_contexts);
+}
+
+// Re-parses only the bytes around a change since the previous source and patches the live nodes they make up:
+// the start tag of an element when the change stays inside it, the run of children that changed when it stays
+// between an element's unchanged children, otherwise the innermost element around it. The live nodes are found by
+// the element's path, counting live children. Returns the number of nodes that changed, or -1 when the change can't
+// be narrowed down (no previous source, the change reaches the root's end tag, the bytes no longer parse on their own
+// or the live tree has no node there). The caller then re-parses the whole file.
+static int NU_Hot_Reload_Patch_Range(struct NU_Hot_Reload* hot_reload, struct UI_Tree* ui_tree, struct File_Map* src_file)
+{
+    char* old_src = hot_reload->source.data;
+    uint32_t old_length = hot_reload->source.size;
+    uint32_t new_length = src_file->length;
+    uint32_t delta = new_length - old_length; // wraps, offsets past the change are shifted by adding it
+    if (old_length == 0) return -1;
+
+    // The changed bytes are [prefix, prefix + old_changed) of the old source
+    uint32_t shorter = MIN(old_length, new_length);
+    uint32_t prefix = NU_Common_Prefix(old_src, src_file->data, shorter);
+    if (prefix == old_length && prefix == new_length) return 0;
+    uint32_t suffix = NU_Common_Suffix(old_src + old_length, src_file->data + new_length, shorter - prefix);
+    uint32_t old_changed = old_length - prefix - suffix;
+    uint32_t new_changed = new_length - prefix - suffix;
+    if (old_changed == 0) prefix = NU_Align_Change(src_file->data, prefix, new_changed);
+    if (new_changed == 0) prefix = NU_Align_Change(old_src, prefix, old_changed);
+    struct NU_Changed_Element changed;
+    if (NU_Find_Changed_Element(old_src, old_length, prefix, prefix + old_changed, 0, &changed) != 0) return -1;
+
+    // The element's live node
+    uint32_t node_ID = 0;
+    for (int d=1; d<=changed.depth; d++)
+    {
+        struct Node* node = Vector_Get(&ui_tree->tree_stack[d-1], node_ID & 0x00FFFFFF);
+        if (changed.path[d] >= node->child_count) return -1;
+        node_ID = ((uint32_t) d << 24) | (node->first_child_index + changed.path[d]);
+    }
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[changed.depth], node_ID & 0x00FFFFFF);
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[changed.depth], node_ID & 0x00FFFFFF);
+    struct UI_Tree* scratch_tree = &hot_reload->scratch_tree;
+    struct Node* stand_in_root = NULL;
+    uint32_t patched = 0;
+
+    // Only the start tag changed -> parse it on its own (closed by a copy of its end tag) and patch the node.
+    // Adding or removing the self closing '/' changes the element, the paths below parse (and report) that
+    char* tag = src_file->data + changed.start;
+    uint32_t tag_length = changed.tag_end + delta - changed.start;
+    if (changed.in_tag && NU_Skip_Tag(src_file->data, new_length, changed.start) + 1 == changed.tag_end + delta &&
+        (old_src[changed.tag_end-2] == '/') == (tag[tag_length-2] == '/'))
+    {
+        uint32_t name_length = 1;
+        while (name_length < tag_length && strchr(" \t\n\r/>", tag[name_length]) == NULL) name_length++;
+        struct Vector element;
+        Vector_Reserve(&element, sizeof(char), tag_length + name_length + 3);
+        Vector_Push_Range(&element, tag, tag_length);
+        if (tag[tag_length-2] != '/')
+        {
+            Vector_Push_Range(&element, "</", 2);
+            Vector_Push_Range(&element, tag + 1, name_length - 1);
+            Vector_Push_Range(&element, ">", 1);
+        }
+        struct File_Map element_file = { element.data, element.size, 0 };
+        int result = NU_Hot_Reload_Parse(hot_reload, &element_file, 0, element.size, 1);
+        scratch_tree->src_file.data = NULL;
+        stand_in_root = Vector_Get(&scratch_tree->tree_stack[0], 0);
+        if (result == 0 && stand_in_root->child_count == 1)
+        {
+            struct Node* new_node = Vector_Get(&scratch_tree->tree_stack[1], 0);
+            struct Node_Cold* new_cold = Vector_Get(&scratch_tree->cold_stack[1], 0);
+            if (new_node->tag == node->tag && new_node->child_count == 0 && new_cold->text_ref_index == -1)
+            {
+                if (NU_Patch_Node_Attributes(ui_tree, node, cold, scratch_tree, new_node, new_cold)) {
+                    NU_Mark_Node_Dirty(ui_tree, node_ID);
+                    patched = 1;
+                }
+                Vector_Free(&element);
+                return (int) patched;
+            }
+        }
+        Vector_Free(&element);
+    }
+
+    // Only children changed -> the run between the unchanged ones
+    if (changed.in_content && changed.run_first + changed.run_count <= node->child_count && !NU_Has_Loose_Text(old_src, changed.run_start, changed.run_end) &&
+        NU_Hot_Reload_Parse(hot_reload, src_file, changed.run_start, changed.run_end + delta, 1) == 0)
+    {
+        stand_in_root = Vector_Get(&scratch_tree->tree_stack[0], 0);
+        int result = NU_Patch_Children(ui_tree, node_ID, changed.run_first, changed.run_count, scratch_tree, 0, 0, stand_in_root->child_count, &patched);
+        scratch_tree->src_file.data = NULL;
+        return result == 0 ? (int) patched : -1;
+    }
+
+    // The element itself (the scan has to reach its end first)
+    scratch_tree->src_file.data = NULL;
+    if (changed.depth == 0) return -1;
+    if (changed.end == 0 && NU_Find_Changed_Element(old_src, old_length, prefix, prefix + old_changed, 1, &changed) != 0) return -1;
+    int result = NU_Hot_Reload_Parse(hot_reload, src_file, changed.start, changed.end + delta, 1);
+    stand_in_root = Vector_Get(&scratch_tree->tree_stack[0], 0);
+    if (result == 0 && stand_in_root->child_count == 1) result = NU_Patch_Subtree(ui_tree, node_ID, scratch_tree, 1 << 24, &patched);
+    else result = -1;
+    scratch_tree->src_file.data = NULL;
+    return result == 0 ? (int) patched : -1;
+}
+
+int NU_Hot_Reload_Init(struct NU_Hot_Reload* hot_reload, char* filepath, struct UI_Tree* ui_tree)
+{
+    hot_reload->filepath = filepath;
+    hot_reload->scratch_ready = 0;
+    NU_Detach_Source_Text(ui_tree);
+    struct File_Map src_file;
+    Vector_Reserve(&hot_reload->source, sizeof(char), 1);
+    if (File_Map_Open(filepath, &src_file) == 0)
+    {
+        Vector_Push_Range(&hot_reload->source, src_file.data, src_file.length);
+        File_Map_Close(&src_file);
+    }
+
+    #ifdef __linux__
+    const char* slash = strrchr(filepath, '/');
+    hot_reload->filename = slash ? slash + 1 : filepath;
+    char directory[4096];
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else if (slash == filepath) {
+        strcpy(directory, "/");
+    } else {
+        uint32_t length = MIN((uint32_t) (slash - filepath), sizeof(directory) - 1);
+        memcpy(directory, filepath, length);
+        directory[length] = '\0';
+    }
+    hot_reload->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (hot_reload->inotify_fd < 0) {
+        fprintf(stderr, "[Hot_Reload] Cannot watch '%s': %s\n", filepath, strerror(errno));
+        return -1;
+    }
+    hot_reload->watch_fd = inotify_add_watch(hot_reload->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (hot_reload->watch_fd < 0) {
+        fprintf(stderr, "[Hot_Reload] Cannot watch '%s': %s\n", filepath, strerror(errno));
+        close(hot_reload->inotify_fd);
+        return -1;
+    }
+    #else
+    struct stat st;
+    hot_reload->last_modified = (stat(filepath, &st) == 0) ? st.st_mtime : 0;
+    #endif
+    return 0; // Success
+}
+
+// Checks for changes to the watched file without blocking. Returns 1 if the tree was patched,
+// 0 if nothing changed and -1 if the new source failed to parse (the live tree is left as it was).
+int NU_Hot_Reload_Poll(struct NU_Hot_Reload* hot_reload, struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    int changed = 0;
+
+    #ifdef __linux__
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length;
+    while ((length = read(hot_reload->inotify_fd, events, sizeof(events))) > 0)
+    {
+        for (char* ptr = events; ptr < events + length; )
+        {
+            struct inotify_event* event = (struct inotify_event*) ptr;
+            if (event->len > 0 && strcmp(event->name, hot_reload->filename) == 0) changed = 1;
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    #else
+    struct stat st;
+    if (stat(hot_reload->filepath, &st) == 0 && st.st_mtime != hot_reload->last_modified) {
+        hot_reload->last_modified = st.st_mtime;
+        changed = 1;
+    }
+    #endif
+    if (!changed) return 0;
+
+    struct File_Map src_file;
+    if (File_Map_Open(hot_reload->filepath, &src_file) != 0) return -1;
+    int patched = NU_Hot_Reload_Patch_Range(hot_reload, ui_tree, &src_file);
+    if (patched == -1)
+    {
+        if (NU_Hot_Reload_Parse(hot_reload, &src_file, 0, src_file.length, 0) != 0)
+        {
+            printf("[Hot_Reload] '%s' failed to parse, keeping the current tree\n", hot_reload->filepath);
+            hot_reload->scratch_tree.src_file.data = NULL;
+            File_Map_Close(&src_file);
+            return -1;
+        }
+        patched = NU_Patch_UI_Tree(ui_tree, &hot_reload->scratch_tree, windows, gl_contexts, nano_vg_contexts);
+        hot_reload->scratch_tree.src_file.data = NULL;
+    }
+    Vector_Resize(&hot_reload->source, src_file.length);
+    memcpy(hot_reload->source.data, src_file.data, src_file.length);
+    File_Map_Close(&src_file);
+    return patched > 0;
+}
+
+void NU_Hot_Reload_Close(struct NU_Hot_Reload* hot_reload)
+{
+    #ifdef __linux__
+    close(hot_reload->inotify_fd);
+    #endif
+    Vector_Free(&hot_reload->source);
+    if (!hot_reload->scratch_ready) return;
+    NU_Free_UI_Tree_Memory(&hot_reload->scratch_tree);
+}
@@ -11,7 +11,7 @@
 #include <freetype/freetype.h>
 
 // UI layout ------------------------------------------------------------
-static void NU_Create_New_Window(struct UI_Tree* ui_tree, struct Node* window_node, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+static void NU_Create_New_Window(struct UI_Tree* ui_tree, struct Node_Cold* window_node, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
 {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
@@ -44,51 +44,64 @@ static void NU_Reset_Node_size(struct Node* node)
 {
     node->x = 0.0f;
     node->y = 0.0f;
-    if (node->preferred_width == 0.0f) node->width = node->border_left + node->border_right + node->pad_left + node->pad_right;
+    if (node->preferred_width == 0.0f || node->width_unit != UNIT_PX) node->width = node->border_left + node->border_right + node->pad_left + node->pad_right;
     else node->width = node->preferred_width;
     node->height = node->border_top + node->border_bottom + node->pad_top + node->pad_bottom;
 }
 
+// Resets the sizes of a node's children (children inherit its window and renderer)
+static void NU_Clear_Children(struct UI_Tree* ui_tree, int l, uint32_t p)
+{
+    struct Node* parent = Vector_Get_Node(&ui_tree->tree_stack[l], p);
+    struct Node_Cold* parent_cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[l], p);
+    struct Vector* child_layer = &ui_tree->tree_stack[l+1];
+    struct Vector* child_cold_layer = &ui_tree->cold_stack[l+1];
+
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        struct Node_Cold* child_cold = Vector_Get_Node_Cold(child_cold_layer, i);
+
+        // Inherit window and renderer from parent
+        if (child->tag != WINDOW && child_cold->window == NULL)
+        {
+            child_cold->window = parent_cold->window;
+            child_cold->vg = parent_cold->vg;
+        }
+
+        NU_Reset_Node_size(child);
+        child->dirty = 0;
+    }
+}
+
 static void NU_Clear_Node_Sizes(struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
 {
     // For each layer
     for (int l=0; l<=ui_tree->deepest_layer; l++)
     {
         struct Vector* parent_layer = &ui_tree->tree_stack[l];
-        struct Vector* child_layer = &ui_tree->tree_stack[l+1];
+        struct Vector* parent_cold_layer = &ui_tree->cold_stack[l];
 
         for (int p=0; p<parent_layer->size; p++)
         {       
             // Iterate over layer
-            struct Node* parent = Vector_Get(parent_layer, p);
+            struct Node* parent = Vector_Get_Node(parent_layer, p);
+            struct Node_Cold* parent_cold = Vector_Get_Node_Cold(parent_cold_layer, p);
 
             // If parent is window node and has no SDL window assigned to it -> create a new window and renderer
-            if (parent->tag == WINDOW && parent->window == NULL) {
-                NU_Create_New_Window(ui_tree, parent, windows, gl_contexts, nano_vg_contexts);
-            }
-
-            if (parent->child_count == 0) continue; // Skip acummulating child sizes (no children)
-
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
-            {
-                struct Node* child = Vector_Get(child_layer, i);
-
-                // Inherit window and renderer from parent
-                if (child->tag != WINDOW && child->window == NULL)
-                {
-                    child->window = parent->window;
-                    child->vg = parent->vg;
-                }
-
-                NU_Reset_Node_size(child);
+            if (parent->tag == WINDOW && parent_cold->window == NULL) {
+                NU_Create_New_Window(ui_tree, parent_cold, windows, gl_contexts, nano_vg_contexts);
             }
+            NU_Clear_Children(ui_tree, l, p);
         }
     }
+    Vector_Get_Node(&ui_tree->tree_stack[0], 0)->dirty = 0;
 }
 
-static void NU_Calculate_Text_Min_Width(struct UI_Tree* ui_tree, struct Node* node, struct Text_Ref* text_ref)
+// Width of the longest space delimited word (0 if the text has no spaces)
+static float NU_Measure_Longest_Word(struct UI_Tree* ui_tree, NVGcontext* vg, struct Text_Ref* text_ref)
 {
-    char* text = ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
+    char* text = NU_Text_Ref_Chars(ui_tree, text_ref);
     int slice_start = 0;
     float max_word_width = 0.0f;
     for (int i=0; i<=text_ref->char_count; i++) {
@@ -96,26 +109,118 @@ static void NU_Calculate_Text_Min_Width(struct UI_Tree* ui_tree, struct Node* no
         if (c == ' ') {
             if (i > slice_start) {
                 float bounds[4];
-                nvgTextBounds(node->vg, 0, 0, text + slice_start, text + i, bounds); // measure slice
+                nvgTextBounds(vg, 0, 0, text + slice_start, text + i, bounds); // measure slice
                 float width = bounds[2] - bounds[0];
                 if (width > max_word_width) max_word_width = width;
             }
             slice_start = i + 1; 
         }
     }
-    if (max_word_width == 0.0f && text_ref->char_count > 0) { // If no spaces found, the whole text is one word
-        float bounds[4];
-        nvgTextBounds(node->vg, 0, 0, text, text + text_ref->char_count, bounds);
-        max_word_width = bounds[2] - bounds[0];
+    return max_word_width;
+}
+
+// Fills the text ref's measurement cache (full width, longest word width and line height) unless it already
+// holds this text measured in this font, so unchanged text costs no fontstash calls
+static void NU_Measure_Text(struct UI_Tree* ui_tree, NVGcontext* vg, struct Text_Ref* text_ref, int font_id, float font_size)
+{
+    if (text_ref->measured_font == font_id && text_ref->measured_size == font_size) return; // cached
+
+    char* text = NU_Text_Ref_Chars(ui_tree, text_ref);
+    nvgFontFaceId(vg, font_id);
+    nvgFontSize(vg, font_size);
+    float asc, desc;
+    float bounds[4];
+    nvgTextMetrics(vg, &asc, &desc, &text_ref->line_height);
+    nvgTextBounds(vg, 0, 0, text, text + text_ref->char_count, bounds);
+    text_ref->text_width = bounds[2] - bounds[0];
+    text_ref->word_width = NU_Measure_Longest_Word(ui_tree, vg, text_ref);
+    if (text_ref->word_width == 0.0f) text_ref->word_width = text_ref->text_width; // If no spaces found, the whole text is one word
+    text_ref->measured_font = font_id;
+    text_ref->measured_size = font_size;
+    text_ref->break_width = -1.0f; // rows of the old text or font
+}
+
+// Packs the rows of every text ref together once the abandoned blocks are half of the rows (call it before
+// breaking new rows onto the end)
+static void NU_Compact_Text_Rows(struct Text_Arena* text_arena)
+{
+    if (text_arena->free_rows <= 4096 || text_arena->free_rows <= text_arena->rows.size / 2) return;
+    struct Text_Row* old_rows = malloc(text_arena->rows.size * sizeof(struct Text_Row));
+    memcpy(old_rows, text_arena->rows.data, text_arena->rows.size * sizeof(struct Text_Row));
+    uint32_t write_index = 0;
+    for (uint32_t i=0; i<text_arena->text_refs.size; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&text_arena->text_refs, i);
+        if (text_ref->row_capacity == 0) continue;
+        memcpy(Vector_Get_Text_Row(&text_arena->rows, write_index), old_rows + text_ref->row_index, text_ref->row_count * sizeof(struct Text_Row));
+        text_ref->row_index = write_index;
+        text_ref->row_capacity = text_ref->row_count;
+        write_index += text_ref->row_count;
+    }
+    text_arena->rows.size = write_index;
+    text_arena->free_rows = 0;
+    free(old_rows);
+}
+
+// Breaks text into rows no wider than width onto the end of rows (struct Text_Row, offsets into text)
+static void NU_Break_Text_Rows(NVGcontext* vg, char* text, uint32_t char_count, float width, struct Vector* rows)
+{
+    char* start = text;
+    char* end = text + char_count;
+    NVGtextRow text_rows[128];
+    int nrows;
+    while ((nrows = nvgTextBreakLines(vg, start, end, width, text_rows, 128)) > 0) {
+        for (int i=0; i<nrows; i++) {
+            struct Text_Row row = { (uint32_t) (text_rows[i].start - text), (uint32_t) (text_rows[i].end - text), text_rows[i].width };
+            Vector_Push_Text_Row(rows, row);
+        }
+        start = (char*) text_rows[nrows-1].next; // continue from last break
+    }
+}
+
+// Gives the text ref the rows from new_index to the end of the rows vector (broken at width)
+static void NU_Store_Text_Rows(struct Text_Arena* text_arena, struct Text_Ref* text_ref, uint32_t new_index, float width)
+{
+    uint32_t row_count = text_arena->rows.size - new_index;
+
+    // Rows that fit the text's block (or its block is the last one) move into it, otherwise the block is abandoned
+    int last_block = text_ref->row_capacity > 0 && text_ref->row_index + text_ref->row_capacity == new_index;
+    if (row_count <= text_ref->row_capacity || last_block)
+    {
+        memmove(Vector_Get_Text_Row(&text_arena->rows, text_ref->row_index), Vector_Get_Text_Row(&text_arena->rows, new_index), row_count * sizeof(struct Text_Row));
+        text_ref->row_capacity = MAX(text_ref->row_capacity, row_count);
+        text_arena->rows.size = last_block ? text_ref->row_index + text_ref->row_capacity : new_index;
     }
-    float text_controlled_min_width = max_word_width + node->pad_left + node->pad_right + node->border_left + node->border_right;
-    node->min_width = max(node->min_width, text_controlled_min_width);
-    // printf("node min width: %f\n", node->min_width);
+    else
+    {
+        text_arena->free_rows += text_ref->row_capacity;
+        text_ref->row_index = new_index;
+        text_ref->row_capacity = row_count;
+    }
+    text_ref->row_count = row_count;
+    text_ref->break_width = width;
+}
+
+// Breaks the text into rows no wider than width unless the text ref already holds this text broken at this
+// width in this font. Layout and drawing share the rows, so a text is only broken again when it changes or
+// its content width does.
+static void NU_Break_Text(struct UI_Tree* ui_tree, NVGcontext* vg, struct Text_Ref* text_ref, int font_id, float font_size, float width)
+{
+    NU_Measure_Text(ui_tree, vg, text_ref, font_id, font_size);
+    if (text_ref->break_width == width) return; // cached
+
+    struct Text_Arena* text_arena = &ui_tree->text_arena;
+    NU_Compact_Text_Rows(text_arena);
+    uint32_t new_index = text_arena->rows.size;
+    nvgFontFaceId(vg, font_id);
+    nvgFontSize(vg, font_size);
+    NU_Break_Text_Rows(vg, NU_Text_Ref_Chars(ui_tree, text_ref), text_ref->char_count, width, &text_arena->rows);
+    NU_Store_Text_Rows(text_arena, text_ref, new_index, width);
 }
 
 static bool Text_Can_Wrap(struct UI_Tree* ui_tree, struct Text_Ref* text_ref) 
 {
-    char* text = ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
+    char* text = NU_Text_Ref_Chars(ui_tree, text_ref);
     if (text_ref->char_count < 2) return false;
     char last_c = ' ';
     char c = text[0];
@@ -128,50 +233,90 @@ static bool Text_Can_Wrap(struct UI_Tree* ui_tree, struct Text_Ref* text_ref)
     return false;
 }
 
-static void NU_Calculate_Text_Fit_Size(struct UI_Tree* ui_tree, struct Node* node, struct Text_Ref* text_ref)
+static void NU_Calculate_Text_Fit_Size(struct UI_Tree* ui_tree, struct Node* node, NVGcontext* vg, struct Text_Ref* text_ref)
 {
-    // Extract pointer to text
-    char* text = ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
-
-    // Make sure the NanoVG context has the correct font/size set before measuring!
+    // Measure with the layout font (cached in the text ref)
     struct Vector* font_registry = Vector_Get(&ui_tree->font_registries, 0);
     int fontID = *(int*) Vector_Get(font_registry, 0);
-    nvgFontFaceId(node->vg, fontID);   
-    nvgFontSize(node->vg, 18);
+    NU_Measure_Text(ui_tree, vg, text_ref, fontID, NU_EM_PX);
 
-    // Calculate text bounds
-    float asc, desc, lh;
-    float bounds[4];
-    nvgTextMetrics(node->vg, &asc, &desc, &lh);
-    nvgTextBounds(node->vg, 0, 0, text, text + text_ref->char_count, bounds);
-    float text_width = bounds[2] - bounds[0];
-    float text_height = lh;
-    
-    NU_Calculate_Text_Min_Width(ui_tree, node, text_ref);
+    // Longest word sets the min width
+    float text_controlled_min_width = text_ref->word_width + node->pad_left + node->pad_right + node->border_left + node->border_right;
+    node->min_width = max(node->min_width, text_controlled_min_width);
     
-    if (node->preferred_width == 0.0f) {
-        node->width = text_width + node->pad_left + node->pad_right + node->border_left + node->border_right;
+    if (node->preferred_width == 0.0f || node->width_unit != UNIT_PX) {
+        node->width = text_ref->text_width + node->pad_left + node->pad_right + node->border_left + node->border_right;
     }
     node->width = min(node->width, node->max_width);
     node->width = max(node->width, node->min_width);
-    node->height += text_height;
+    node->height += text_ref->line_height;
 }
 
 static void NU_Calculate_Text_Fit_Sizes(struct UI_Tree* ui_tree)
 {
     for (uint32_t i=0; i<ui_tree->text_arena.text_refs.size; i++)
     {
-        struct Text_Ref* text_ref = (struct Text_Ref*) Vector_Get(&ui_tree->text_arena.text_refs, i);
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, i);
         
         // Get the corresponding node
         uint8_t node_depth = (uint8_t)(text_ref->node_ID >> 24);
         uint32_t node_index = text_ref->node_ID & 0x00FFFFFF;
         struct Vector* layer = &ui_tree->tree_stack[node_depth];
-        struct Node* node = Vector_Get(layer, node_index);
+        struct Node* node = Vector_Get_Node(layer, node_index);
+        struct Node_Cold* cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[node_depth], node_index);
 
         // Calculate text size
-        NU_Calculate_Text_Fit_Size(ui_tree, node, text_ref);
+        NU_Calculate_Text_Fit_Size(ui_tree, node, cold->vg, text_ref);
+    }
+}
+
+// Sums the children's fit widths into the node's width (a window keeps its window's width)
+static void NU_Fit_Node_Width(struct UI_Tree* ui_tree, int l, uint32_t p)
+{
+    struct Node* parent = Vector_Get_Node(&ui_tree->tree_stack[l], p);
+    int is_layout_horizontal = (parent->layout_flags & 0x01) == LAYOUT_HORIZONTAL;
+
+    if (parent->tag == WINDOW) {
+        int window_width, window_height;
+        SDL_GetWindowSize(Vector_Get_Node_Cold(&ui_tree->cold_stack[l], p)->window, &window_width, &window_height);
+        parent->width = (float) window_width;
+        parent->height = (float) window_height;
+    }
+
+    if (parent->child_count == 0) {
+        parent->fit_width = parent->width;
+        return; // Skip acummulating child sizes (no children)
+    }
+
+    // Track the total width for the parent's content
+    float content_width = 0;
+
+    // Iterate over children
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(&ui_tree->tree_stack[l+1], i);
+        float child_width = child->fit_width;
+
+        if (child->tag == WINDOW) {
+            if (is_layout_horizontal) content_width -= parent->gap + child_width;
+        }
+
+        // Dont' accumulate if parent is a window
+        if (is_layout_horizontal) { // Horizontal Layout
+            content_width += child_width;
+        }
+
+        if (!is_layout_horizontal) { // Vertical Layout
+            content_width = MAX(content_width, child_width);
+        }
+    }
+
+    // Grow parent node
+    if (is_layout_horizontal) content_width += (parent->child_count - 1) * parent->gap;
+    if (parent->tag != WINDOW) {
+        parent->width = content_width + parent->border_left + parent->border_right + parent->pad_left + parent->pad_right;
     }
+    parent->fit_width = parent->width;
 }
 
 static void NU_Calculate_Fit_Size_Widths(struct UI_Tree* ui_tree)
@@ -181,56 +326,53 @@ static void NU_Calculate_Fit_Size_Widths(struct UI_Tree* ui_tree)
     // For each layer
     for (int l=ui_tree->deepest_layer; l>=0; l--)
     {
-        struct Vector* parent_layer = &ui_tree->tree_stack[l];
-        struct Vector* child_layer = &ui_tree->tree_stack[l+1];
-        
         // Iterate over layer
-        for (int p=0; p<parent_layer->size; p++)
-        {   
-            struct Node* parent = Vector_Get(parent_layer, p);
-            int is_layout_horizontal = (parent->layout_flags & 0x01) == LAYOUT_HORIZONTAL;
-
-            if (parent->tag == WINDOW) {
-                int window_width, window_height;
-                SDL_GetWindowSize(parent->window, &window_width, &window_height);
-                parent->width = (float) window_width;
-                parent->height = (float) window_height;
-            }
+        for (uint32_t p=0; p<ui_tree->tree_stack[l].size; p++) {
+            NU_Fit_Node_Width(ui_tree, l, p);
+        }
+    }
+}
 
-            if (parent->child_count == 0) {
-                continue; // Skip acummulating child sizes (no children)
-            }
-            
-            // Track the total width for the parent's content
-            float content_width = 0;
+// Sums the children's fit heights into the node's height (a window keeps its window's height)
+static void NU_Fit_Node_Height(struct UI_Tree* ui_tree, int l, uint32_t p)
+{
+    struct Node* parent = Vector_Get_Node(&ui_tree->tree_stack[l], p);
+    int is_layout_horizontal = (parent->layout_flags & 0x01) == LAYOUT_HORIZONTAL;
 
-            // Iterate over children
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
-            {
-                struct Node* child = Vector_Get(child_layer, i);
+    if (parent->child_count == 0) {
+        parent->fit_height = parent->height;
+        return; // Skip acummulating child sizes (no children)
+    }
 
-                if (child->tag == WINDOW) {
-                    if (is_layout_horizontal) content_width -= parent->gap + child->width;
-                }   
+    // Track the total height for the parent's content
+    float content_height = 0;
 
-                // Dont' accumulate if parent is a window
-                if (is_layout_horizontal) { // Horizontal Layout
-                    content_width += child->width;
-                }
+    // Iterate over children
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(&ui_tree->tree_stack[l+1], i);
+        float child_height = child->fit_height;
 
-                if (!is_layout_horizontal) { // Vertical Layout
-                    content_width = MAX(content_width, child->width);
-                }
-            }
+        if (child->tag == WINDOW) {
+            if (!is_layout_horizontal) content_height -= parent->gap + child_height;
+        }
 
-            // Grow parent node
-            if (is_layout_horizontal) content_width += (parent->child_count - 1) * parent->gap;
-            parent->content_width = content_width;
-            if (parent->tag != WINDOW) {
-                parent->width = content_width + parent->border_left + parent->border_right + parent->pad_left + parent->pad_right;
-            }
+        // Dont' accumulate if parent is a window
+        if (is_layout_horizontal) { // Horizontal Layout
+            content_height = MAX(content_height, child_height);
+        }
+
+        if (!is_layout_horizontal) { // Vertical Layout
+            content_height += child_height;
         }
     }
+
+    // Grow parent node
+    if (!is_layout_horizontal) content_height += (parent->child_count - 1) * parent->gap;
+    if (parent->tag != WINDOW) {
+        parent->height = content_height + parent->border_top + parent->border_bottom + parent->pad_top + parent->pad_bottom;
+    }
+    parent->fit_height = parent->height;
 }
 
 static void NU_Calculate_Fit_Size_Heights(struct UI_Tree* ui_tree)
@@ -240,61 +382,128 @@ static void NU_Calculate_Fit_Size_Heights(struct UI_Tree* ui_tree)
     // For each layer
     for (int l=ui_tree->deepest_layer; l>=0; l--)
     {
-        struct Vector* parent_layer = &ui_tree->tree_stack[l];
-        struct Vector* child_layer = &ui_tree->tree_stack[l+1];
-        
         // Iterate over layer
-        for (int p=0; p<parent_layer->size; p++)
-        {   
-            struct Node* parent = Vector_Get(parent_layer, p);
-            int is_layout_horizontal = (parent->layout_flags & 0x01) == LAYOUT_HORIZONTAL;
+        for (uint32_t p=0; p<ui_tree->tree_stack[l].size; p++) {
+            NU_Fit_Node_Height(ui_tree, l, p);
+        }
+    }
+}
 
-            if (parent->child_count == 0) {
-                continue; // Skip acummulating child sizes (no children)
-            }
-            
-            // Track the total height for the parent's content
-            float content_height = 0;
+// Percentage sizes are a fraction of the parent's content box (known once the parent has grown)
+static void NU_Resolve_Percent_Widths(struct Node* parent, struct Vector* child_layer, float content_width)
+{
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->width_unit != UNIT_PERCENT || child->tag == WINDOW) continue;
+        child->width = content_width * child->preferred_width * 0.01f;
+        child->width = min(child->width, child->max_width);
+        child->width = max(child->width, child->min_width);
+    }
+}
 
-            // Iterate over children
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
-            {
-                struct Node* child = Vector_Get(child_layer, i);
+static void NU_Resolve_Percent_Heights(struct Node* parent, struct Vector* child_layer, float content_height)
+{
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->height_unit != UNIT_PERCENT || child->tag == WINDOW) continue;
+        child->height = content_height * child->preferred_height * 0.01f;
+        child->height = min(child->height, child->max_height);
+        child->height = max(child->height, child->min_height);
+    }
+}
+
+// Hands the free space along the layout axis to fr children in proportion to their fr value. Returns the space left.
+static float NU_Distribute_Fr_Widths(struct Node* parent, struct Vector* child_layer, float remaining_width)
+{
+    float total_fr = 0.0f;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->width_unit == UNIT_FR && child->tag != WINDOW) total_fr += child->preferred_width;
+    }
+    if (total_fr == 0.0f || remaining_width <= 0.0f) return remaining_width;
+
+    float free_width = remaining_width;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->width_unit != UNIT_FR || child->tag == WINDOW) continue;
+        float grow = min(free_width * child->preferred_width / total_fr, child->max_width - child->width);
+        if (grow > 0.0f) {
+            child->width += grow;
+            remaining_width -= grow;
+        }
+    }
+    return remaining_width;
+}
 
-                if (child->tag == WINDOW) {
-                    if (!is_layout_horizontal) content_height -= parent->gap + child->height;
-                }   
+static float NU_Distribute_Fr_Heights(struct Node* parent, struct Vector* child_layer, float remaining_height)
+{
+    float total_fr = 0.0f;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->height_unit == UNIT_FR && child->tag != WINDOW) total_fr += child->preferred_height;
+    }
+    if (total_fr == 0.0f || remaining_height <= 0.0f) return remaining_height;
+
+    float free_height = remaining_height;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        if (child->height_unit != UNIT_FR || child->tag == WINDOW) continue;
+        float grow = min(free_height * child->preferred_height / total_fr, child->max_height - child->height);
+        if (grow > 0.0f) {
+            child->height += grow;
+            remaining_height -= grow;
+        }
+    }
+    return remaining_height;
+}
 
-                // Dont' accumulate if parent is a window
-                if (is_layout_horizontal) { // Horizontal Layout
-                    content_height = MAX(content_height, child->height);
-                }
+// Water-filling: a child takes part from the size it starts at (delta 1) to the limit it stops at (delta -1)
+struct NU_Fill_Event
+{
+    float size;
+    int delta;
+};
 
-                if (!is_layout_horizontal) { // Vertical Layout
-                    content_height += child->height;
-                }
-            }
+static int NU_Compare_Fill_Events(const void* a, const void* b)
+{
+    float size_a = ((const struct NU_Fill_Event*) a)->size;
+    float size_b = ((const struct NU_Fill_Event*) b)->size;
+    return (size_a > size_b) - (size_a < size_b);
+}
 
-            // Grow parent node
-            if (!is_layout_horizontal) content_height += (parent->child_count - 1) * parent->gap;
-            parent->content_height = content_height;
-            if (parent->tag != WINDOW) {
-                parent->height = content_height + parent->border_top + parent->border_bottom + parent->pad_top + parent->pad_bottom;
-            }
-        }
+// Returns the level the smallest children rise to together (each one stopping at its limit) when amount is shared
+// between them. The events are sorted once and swept in one pass, so n children cost O(n log n).
+static float NU_Fill_Level(struct NU_Fill_Event* events, uint32_t event_count, float amount)
+{
+    qsort(events, event_count, sizeof(struct NU_Fill_Event), NU_Compare_Fill_Events);
+    float level = events[0].size;
+    int rising = 0;
+    for (uint32_t e=0; e<event_count; e++)
+    {
+        float capacity = rising * (events[e].size - level);
+        if (rising > 0 && capacity >= amount) return level + amount / rising;
+        amount -= capacity;
+        level = events[e].size;
+        rising += events[e].delta;
     }
+    return level; // every child reached its limit
 }
 
+#define NU_FILL_STACK_EVENTS 64
+
 static void NU_Grow_Shrink_Child_Node_Widths(struct Node* parent, struct Vector* child_layer)
 {
     float remaining_width = parent->width - parent->pad_left - parent->pad_right - parent->border_left - parent->border_right - ((parent->layout_flags & OVERFLOW_VERTICAL_SCROLL) != 0) * 12.0f;
+    NU_Resolve_Percent_Widths(parent, child_layer, remaining_width);
 
     if (parent->layout_flags & LAYOUT_VERTICAL)
     {   
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
-            if (child->layout_flags & GROW_HORIZONTAL)
+            struct Node* child = Vector_Get_Node(child_layer, i);
+            if ((child->layout_flags & GROW_HORIZONTAL) || child->width_unit == UNIT_FR)
             {
                 child->width = remaining_width; 
                 child->width = min(child->width, child->max_width);
@@ -307,117 +516,64 @@ static void NU_Grow_Shrink_Child_Node_Widths(struct Node* parent, struct Vector*
         uint32_t growable_count = 0;
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             if (child->tag == WINDOW) remaining_width += parent->gap;
             else remaining_width -= child->width;
             if (child->layout_flags & GROW_HORIZONTAL && child->tag != WINDOW) growable_count++;
         }
         remaining_width -= (parent->child_count - 1) * parent->gap;
+        remaining_width = NU_Distribute_Fr_Widths(parent, child_layer, remaining_width);
         if (growable_count == 0) return;
 
-        // Grow elements
-        while (remaining_width > 0.01f)
-        {   
-            // Determine smallest, second smallest and growable count
-            float smallest = 1e20f;
-            float second_smallest = 1e30f;
-            growable_count = 0;
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if ((child->layout_flags & GROW_HORIZONTAL) && child->tag != WINDOW && child->width < child->max_width) {
-                    growable_count++;
-                    if (child->width < smallest) {
-                        second_smallest = smallest;
-                        smallest = child->width;
-                    } else if (child->width < second_smallest) {
-                        second_smallest = child->width;
-                    }
-                }
-            }
+        if (remaining_width <= 0.01f && remaining_width >= -0.01f) return;
 
-            // Calculate width to add
-            float width_to_add = remaining_width / (float)growable_count;
-            if (second_smallest > smallest) {
-                width_to_add = min(width_to_add, second_smallest - smallest);
+        // Growing raises the narrowest children to a common width (up to their max width), shrinking lowers the
+        // widest ones (down to their min width)
+        int grow = remaining_width > 0.0f;
+        struct NU_Fill_Event stack_events[NU_FILL_STACK_EVENTS];
+        struct NU_Fill_Event* events = growable_count * 2 <= NU_FILL_STACK_EVENTS ? stack_events : malloc(growable_count * 2 * sizeof(struct NU_Fill_Event));
+        uint32_t event_count = 0;
+        for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+        {
+            struct Node* child = Vector_Get_Node(child_layer, i);
+            if (!(child->layout_flags & GROW_HORIZONTAL) || child->tag == WINDOW) continue;
+            if (grow && child->width < child->max_width)
+            {
+                events[event_count++] = (struct NU_Fill_Event) { child->width, 1 };
+                events[event_count++] = (struct NU_Fill_Event) { child->max_width, -1 };
             }
-
-            // for each child
-            bool grew_any = false;
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);            
-                if (child->layout_flags & GROW_HORIZONTAL && child->tag != WINDOW && child->width < child->max_width) {// if child is growable
-                    if (child->width == smallest) {
-                        float available = child->max_width - child->width;
-                        float grow = min(width_to_add, available);
-                        if (grow > 0.0f) {
-                            child->width += grow;
-                            remaining_width -= grow;
-                            grew_any = true;
-                        }
-                    }
-                }
+            if (!grow && child->width > child->min_width) // shrinking is growing the negated widths
+            {
+                events[event_count++] = (struct NU_Fill_Event) { -child->width, 1 };
+                events[event_count++] = (struct NU_Fill_Event) { -child->min_width, -1 };
             }
-            if (!grew_any) break;
         }
-
-        // Shrink elements
-        while (remaining_width < -0.01f)
+        if (event_count > 0)
         {
-            // Determine largest, second largest and shrinkable count
-            float largest = -1e20f;
-            float second_largest = -1e30f;
-            int shrinkable_count = 0;
-            
-            for (int i = parent->first_child_index; i < parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if ((child->layout_flags & GROW_HORIZONTAL) && child->tag != WINDOW && child->width > child->min_width) {
-                    shrinkable_count++;
-                    if (child->width > largest) {
-                        second_largest = largest;
-                        largest = child->width;
-                    } else if (child->width > second_largest) {
-                        second_largest = child->width;
-                    }
-                }
-            }
-
-            // Calculate width to subtract
-            float width_to_subtract = -remaining_width / (float)shrinkable_count;
-            if (second_largest < largest && second_largest >= 0) {
-                width_to_subtract = min(width_to_subtract, largest - second_largest);
-            }
-
-            // For each child
-            bool shrunk_any = false;
-            for (int i = parent->first_child_index; i < parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if ((child->layout_flags & GROW_HORIZONTAL) && child->tag != WINDOW && child->width > child->min_width) {
-                    if (child->width == largest) {
-                        float available = child->width - child->min_width;
-                        float shrink = min(width_to_subtract, available);
-                        if (shrink > 0.0f) {
-                            child->width -= shrink;
-                            remaining_width += shrink;
-                            shrunk_any = true;
-                        }
-                    }
-                }
+            float level = NU_Fill_Level(events, event_count, grow ? remaining_width : -remaining_width);
+            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+            {
+                struct Node* child = Vector_Get_Node(child_layer, i);
+                if (!(child->layout_flags & GROW_HORIZONTAL) || child->tag == WINDOW) continue;
+                if (grow && child->width < min(level, child->max_width)) child->width = min(level, child->max_width);
+                if (!grow && child->width > max(-level, child->min_width)) child->width = max(-level, child->min_width);
             }
-            if (!shrunk_any) break;
         }
+        if (events != stack_events) free(events);
     }
 }
 
 static void NU_Grow_Shrink_Child_Node_Heights(struct Node* parent, struct Vector* child_layer)
 {
     float remaining_height = parent->height - parent->pad_top - parent->pad_bottom - parent->border_top - parent->border_bottom - ((parent->layout_flags & OVERFLOW_HORIZONTAL_SCROLL) != 0) * 12.0f;
+    NU_Resolve_Percent_Heights(parent, child_layer, remaining_height);
 
     if (!(parent->layout_flags & LAYOUT_VERTICAL))
     {
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
-            if (child->layout_flags & GROW_VERTICAL)
+            struct Node* child = Vector_Get_Node(child_layer, i);
+            if ((child->layout_flags & GROW_VERTICAL) || child->height_unit == UNIT_FR)
             {
                 child->height = remaining_height; 
                 child->height = min(child->height, child->max_height);
@@ -430,56 +586,39 @@ static void NU_Grow_Shrink_Child_Node_Heights(struct Node* parent, struct Vector
         uint32_t growable_count = 0;
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             if (child->tag == WINDOW) remaining_height += parent->gap;
             else remaining_height -= child->height;
             if (child->layout_flags & GROW_VERTICAL && child->tag != WINDOW) growable_count++;
         }
         remaining_height -= (parent->child_count - 1) * parent->gap;
+        remaining_height = NU_Distribute_Fr_Heights(parent, child_layer, remaining_height);
         if (growable_count == 0) return;
 
-        while (remaining_height > 0.001f)
+        if (remaining_height <= 0.001f) return;
+
+        // Raise the shortest children to a common height (up to their max height)
+        struct NU_Fill_Event stack_events[NU_FILL_STACK_EVENTS];
+        struct NU_Fill_Event* events = growable_count * 2 <= NU_FILL_STACK_EVENTS ? stack_events : malloc(growable_count * 2 * sizeof(struct NU_Fill_Event));
+        uint32_t event_count = 0;
+        for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            // Find smallest and second smallest
-            float smallest = 1e20f;
-            for (int i = parent->first_child_index; i < parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if ((child->layout_flags & GROW_VERTICAL) && child->tag != WINDOW) {
-                    smallest = child->height;
-                    break;
-                }
-            }
-            float second_smallest = 1e200;
-            float height_to_add = remaining_height;
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if (child->layout_flags & GROW_VERTICAL && child->tag != WINDOW) {
-                    if (child->height < smallest) {
-                        second_smallest = smallest;
-                        smallest = child->height;
-                    }
-                    else if (child->height > smallest) {
-                        second_smallest = min(child->height, second_smallest);
-                        height_to_add = second_smallest - smallest;
-                    }
-                }
-            }
-            height_to_add = min(height_to_add, remaining_height / growable_count);
-
-            // for each child
-            bool grew_any = false;
-            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++) {
-                struct Node* child = Vector_Get(child_layer, i);
-                if (child->layout_flags & GROW_VERTICAL && child->tag != WINDOW) { // if child is growable
-                    if (child->height == smallest) {
-                        child->height += height_to_add;
-                        remaining_height -= height_to_add;
-                        grew_any = true;
-                    }
-                }
+            struct Node* child = Vector_Get_Node(child_layer, i);
+            if (!(child->layout_flags & GROW_VERTICAL) || child->tag == WINDOW || child->height >= child->max_height) continue;
+            events[event_count++] = (struct NU_Fill_Event) { child->height, 1 };
+            events[event_count++] = (struct NU_Fill_Event) { child->max_height, -1 };
+        }
+        if (event_count > 0)
+        {
+            float level = NU_Fill_Level(events, event_count, remaining_height);
+            for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+            {
+                struct Node* child = Vector_Get_Node(child_layer, i);
+                if (!(child->layout_flags & GROW_VERTICAL) || child->tag == WINDOW) continue;
+                if (child->height < min(level, child->max_height)) child->height = min(level, child->max_height);
             }
-            if (!grew_any) break;
         }
+        if (events != stack_events) free(events);
     }
 }
 
@@ -492,7 +631,7 @@ static void NU_Grow_Shrink_Widths(struct UI_Tree* ui_tree)
         
         for (int p=0; p<parent_layer->size; p++) // For node in layer
         {   
-            struct Node* parent = Vector_Get(parent_layer, p);
+            struct Node* parent = Vector_Get_Node(parent_layer, p);
             NU_Grow_Shrink_Child_Node_Widths(parent, child_layer);
         }
     }
@@ -507,17 +646,27 @@ static void NU_Grow_Shrink_Heights(struct UI_Tree* ui_tree)
         
         for (int p=0; p<parent_layer->size; p++) // For node in layer
         {   
-            struct Node* parent = Vector_Get(parent_layer, p);
+            struct Node* parent = Vector_Get_Node(parent_layer, p);
             NU_Grow_Shrink_Child_Node_Heights(parent, child_layer);
         }
     }
 }
 
+// Height of a text that wraps at the node's content width
+static void NU_Calculate_Text_Wrap_Height(struct UI_Tree* ui_tree, struct Node* node, NVGcontext* vg, struct Text_Ref* text_ref)
+{
+    struct Vector* font_registry = Vector_Get(&ui_tree->font_registries, 0);
+    int fontID = *(int*) Vector_Get(font_registry, 0);
+    float inner_width = node->width - node->border_left - node->border_right - node->pad_left - node->pad_right;
+    NU_Break_Text(ui_tree, vg, text_ref, fontID, NU_EM_PX, inner_width);
+    node->height = node->border_top + node->border_bottom + node->pad_top + node->pad_bottom + text_ref->row_count * text_ref->line_height;
+}
+
 static void NU_Calculate_Text_Wrap_Heights(struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
 {
     for (uint32_t i=0; i<ui_tree->text_arena.text_refs.size; i++)
     {
-        struct Text_Ref* text_ref = (struct Text_Ref*) Vector_Get(&ui_tree->text_arena.text_refs, i);
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, i);
 
         // Skip if text cannot wrap
         if (!Text_Can_Wrap(ui_tree, text_ref)) {
@@ -528,28 +677,9 @@ static void NU_Calculate_Text_Wrap_Heights(struct UI_Tree* ui_tree, struct Vecto
         uint8_t node_depth = (uint8_t)(text_ref->node_ID >> 24);
         uint32_t node_index = text_ref->node_ID & 0x00FFFFFF;
         struct Vector* layer = &ui_tree->tree_stack[node_depth];
-        struct Node* node = Vector_Get(layer, node_index);
-
-        char* text = ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
-
-        // Make sure font/size is set first
-        struct Vector* font_registry = Vector_Get(&ui_tree->font_registries, 0);
-        int fontID = *(int*) Vector_Get(font_registry, 0);
-        nvgFontFaceId(node->vg, fontID);   
-        nvgFontSize(node->vg, 18);
-
-        // Calculate text height after wrapping
-        float asc, desc, lh;
-        nvgTextMetrics(node->vg, &asc, &desc, &lh);
-        NVGtextRow rows[128];
-        int nrows;
-        float total_height = 0;
-        char* start = text;  // start as a pointer
-        while ((nrows = nvgTextBreakLines(node->vg, start, NULL, node->width, rows, 128)) > 0) {
-            total_height += nrows * lh;
-            start = (char*) rows[nrows-1].end;  // continue from last break
-        }
-        node->height = node->border_top + node->border_bottom + node->pad_top + node->pad_bottom + total_height;
+        struct Node* node = Vector_Get_Node(layer, node_index);
+        NVGcontext* vg = Vector_Get_Node_Cold(&ui_tree->cold_stack[node_depth], node_index)->vg;
+        NU_Calculate_Text_Wrap_Height(ui_tree, node, vg, text_ref);
     }
 }
 
@@ -559,7 +689,7 @@ static void NU_Horizontally_Place_Children(struct Node* parent, struct Vector* c
     {   
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             float remaning_width = parent->width - child->width;
             float x_align_offset = remaning_width * 0.5f * (float)parent->horizontal_alignment;
             child->x = child->border_left + child->pad_left + parent->x + x_align_offset;
@@ -571,7 +701,7 @@ static void NU_Horizontally_Place_Children(struct Node* parent, struct Vector* c
         float remaining_width = parent->width - parent->pad_left - parent->pad_right - parent->border_left - parent->border_right - (parent->child_count - 1) * parent->gap - ((parent->layout_flags & OVERFLOW_VERTICAL_SCROLL) != 0) * 12.0f;
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             if (child->tag == WINDOW) remaining_width += parent->gap;
             else remaining_width -= child->width;
         }
@@ -580,7 +710,7 @@ static void NU_Horizontally_Place_Children(struct Node* parent, struct Vector* c
 
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             float x_align_offset = remaining_width * 0.5f * (float)parent->horizontal_alignment;
             child->x = child->border_left + child->pad_left + parent->x + cursor_x + x_align_offset;
             cursor_x += child->width + parent->gap;
@@ -594,7 +724,7 @@ static void NU_Vertically_Place_Children(struct Node* parent, struct Vector* chi
     {   
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             float remaning_height = parent->height - child->height;
             float y_align_offset = remaning_height * 0.5f * (float)parent->vertical_alignment;
             child->y = child->border_top + child->pad_top + parent->y + y_align_offset;
@@ -606,7 +736,7 @@ static void NU_Vertically_Place_Children(struct Node* parent, struct Vector* chi
         float remaining_height = parent->height - parent->pad_top - parent->pad_bottom - parent->border_top - parent->border_bottom - (parent->child_count - 1) * parent->gap - ((parent->layout_flags & OVERFLOW_HORIZONTAL_SCROLL) != 0) * 12.0f;
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             if (child->tag == WINDOW) remaining_height += parent->gap;
             else remaining_height -= child->width;
         }
@@ -615,7 +745,7 @@ static void NU_Vertically_Place_Children(struct Node* parent, struct Vector* chi
 
         for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
         {
-            struct Node* child = Vector_Get(child_layer, i);
+            struct Node* child = Vector_Get_Node(child_layer, i);
             float y_align_offset = remaining_height * 0.5f * (float)parent->vertical_alignment;
             child->y = child->border_top + child->pad_top + parent->y + cursor_y + y_align_offset;
             cursor_y += child->height + parent->gap;
@@ -623,6 +753,18 @@ static void NU_Vertically_Place_Children(struct Node* parent, struct Vector* chi
     }
 }
 
+static void NU_Place_Children(struct Node* parent, struct Vector* child_layer)
+{
+    if (parent->tag == WINDOW)
+    {
+        parent->x = 0;
+        parent->y = 0;
+    }
+
+    NU_Horizontally_Place_Children(parent, child_layer);
+    NU_Vertically_Place_Children(parent, child_layer);
+}
+
 static void NU_Calculate_Positions(struct UI_Tree* ui_tree)
 {
     for (int l=0; l<=ui_tree->deepest_layer; l++) // For each layer
@@ -632,25 +774,600 @@ static void NU_Calculate_Positions(struct UI_Tree* ui_tree)
         
         for (int p=0; p<parent_layer->size; p++) // For node in layer
         {   
-            struct Node* parent = Vector_Get(parent_layer, p);
+            struct Node* parent = Vector_Get_Node(parent_layer, p);
+            NU_Place_Children(parent, child_layer);
+        }
+    }
+}
 
-            if (parent->tag == WINDOW)
+// Incremental layout: only the marked nodes (see NU_Mark_Node_Dirty) go through the passes, in the same order
+// as the full layout. Each pass lists the children it changes so the passes after it lay them out too, a child
+// that comes out the same keeps its subtree as it is. A node keeps its fit size (before growing) so a parent
+// can be fitted again without its clean children. A change costs the nodes along its path and their siblings.
+static struct Node* NU_Listed_Node(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    return Vector_Get_Node(&ui_tree->tree_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+}
+
+// Lists the marked nodes, parents before their children (a marked node's ancestors are marked too)
+static void NU_Collect_Dirty_Nodes(struct UI_Tree* ui_tree, struct Vector* list)
+{
+    Vector_Push_Uint32(list, 0);
+    for (uint32_t n=0; n<list->size; n++)
+    {
+        uint32_t node_ID = *Vector_Get_Uint32(list, n);
+        uint32_t l = node_ID >> 24;
+        struct Node* node = NU_Listed_Node(ui_tree, node_ID);
+        node->dirty |= NU_DIRTY_LISTED;
+        for (int i=node->first_child_index; i<node->first_child_index + node->child_count; i++) {
+            if (Vector_Get_Node(&ui_tree->tree_stack[l+1], i)->dirty) Vector_Push_Uint32(list, ((l+1) << 24) | i);
+        }
+    }
+}
+
+// Grows a listed node's children again from their fit sizes (axis 0 -> widths, 1 -> heights) and lists the
+// children whose size changed
+static void NU_Regrow_Children(struct UI_Tree* ui_tree, uint32_t node_ID, int axis, struct Vector* list, struct Vector* old_sizes)
+{
+    uint32_t l = node_ID >> 24;
+    struct Node* parent = NU_Listed_Node(ui_tree, node_ID);
+    struct Vector* child_layer = &ui_tree->tree_stack[l+1];
+    if (parent->child_count == 0) return;
+
+    old_sizes->size = 0;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        Vector_Push_Float(old_sizes, axis == 0 ? child->width : child->height);
+        if (axis == 0) child->width = child->fit_width;
+        else child->height = child->fit_height;
+    }
+    if (axis == 0) NU_Grow_Shrink_Child_Node_Widths(parent, child_layer);
+    else NU_Grow_Shrink_Child_Node_Heights(parent, child_layer);
+
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        float old_size = *Vector_Get_Float(old_sizes, i - parent->first_child_index);
+        if ((axis == 0 ? child->width : child->height) == old_size || (child->dirty & NU_DIRTY_LISTED)) continue;
+        child->dirty |= NU_DIRTY_LISTED;
+        Vector_Push_Uint32(list, ((l+1) << 24) | i);
+    }
+}
+
+// Places a listed node's children and lists the ones that moved (their own children move with them)
+static void NU_Replace_Children(struct UI_Tree* ui_tree, uint32_t node_ID, struct Vector* list, struct Vector* old_positions)
+{
+    uint32_t l = node_ID >> 24;
+    struct Node* parent = NU_Listed_Node(ui_tree, node_ID);
+    struct Vector* child_layer = &ui_tree->tree_stack[l+1];
+
+    old_positions->size = 0;
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        Vector_Push_Float(old_positions, child->x);
+        Vector_Push_Float(old_positions, child->y);
+    }
+    NU_Place_Children(parent, child_layer);
+
+    for (int i=parent->first_child_index; i<parent->first_child_index + parent->child_count; i++)
+    {
+        struct Node* child = Vector_Get_Node(child_layer, i);
+        float* old_position = Vector_Get_Float(old_positions, (i - parent->first_child_index) * 2);
+        if ((child->x == old_position[0] && child->y == old_position[1]) || child->child_count == 0 || (child->dirty & NU_DIRTY_LISTED)) continue;
+        child->dirty |= NU_DIRTY_LISTED;
+        Vector_Push_Uint32(list, ((l+1) << 24) | i);
+    }
+}
+
+static void NU_Layout_Dirty_Nodes(struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    struct Vector list;
+    struct Vector old_values;
+    Vector_Reserve(&list, sizeof(uint32_t), 64);
+    Vector_Reserve(&old_values, sizeof(float), 64);
+    NU_Collect_Dirty_Nodes(ui_tree, &list);
+    uint32_t dirty_count = list.size;
+
+    // Clear sizes and fit text (windows are created and inherited as in NU_Clear_Node_Sizes)
+    for (uint32_t n=0; n<dirty_count; n++)
+    {
+        uint32_t node_ID = *Vector_Get_Uint32(&list, n);
+        uint32_t l = node_ID >> 24;
+        struct Node* node = NU_Listed_Node(ui_tree, node_ID);
+        struct Node_Cold* cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[l], node_ID & 0x00FFFFFF);
+        if (l > 0)
+        {
+            struct Node_Cold* parent_cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[l-1], node->parent_index);
+            if (node->tag != WINDOW && cold->window == NULL)
             {
-                parent->x = 0;
-                parent->y = 0;
+                cold->window = parent_cold->window;
+                cold->vg = parent_cold->vg;
             }
+            NU_Reset_Node_size(node);
+        }
+        if (node->tag == WINDOW && cold->window == NULL) {
+            NU_Create_New_Window(ui_tree, cold, windows, gl_contexts, nano_vg_contexts);
+        }
+        if (cold->text_ref_index != -1) {
+            NU_Calculate_Text_Fit_Size(ui_tree, node, cold->vg, Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, cold->text_ref_index));
+        }
+    }
+
+    // Fit widths children first, then grow them parents first
+    if (ui_tree->deepest_layer > 0)
+    {
+        for (uint32_t n=dirty_count; n-- > 0; )
+        {
+            uint32_t node_ID = *Vector_Get_Uint32(&list, n);
+            NU_Fit_Node_Width(ui_tree, node_ID >> 24, node_ID & 0x00FFFFFF);
+        }
+    }
+    for (uint32_t n=0; n<list.size; n++) {
+        NU_Regrow_Children(ui_tree, *Vector_Get_Uint32(&list, n), 0, &list, &old_values);
+    }
+
+    // Nodes listed for a new width start from their fit height, text wraps at the new widths
+    for (uint32_t n=0; n<list.size; n++)
+    {
+        uint32_t node_ID = *Vector_Get_Uint32(&list, n);
+        struct Node* node = NU_Listed_Node(ui_tree, node_ID);
+        struct Node_Cold* cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+        if (n >= dirty_count) node->height = node->fit_height;
+        if (cold->text_ref_index == -1) continue;
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, cold->text_ref_index);
+        if (Text_Can_Wrap(ui_tree, text_ref)) NU_Calculate_Text_Wrap_Height(ui_tree, node, cold->vg, text_ref);
+    }
+
+    // Fit heights children first, grow them and place the children parents first
+    if (ui_tree->deepest_layer > 0)
+    {
+        for (uint32_t n=list.size; n-- > 0; )
+        {
+            uint32_t node_ID = *Vector_Get_Uint32(&list, n);
+            NU_Fit_Node_Height(ui_tree, node_ID >> 24, node_ID & 0x00FFFFFF);
+        }
+    }
+    for (uint32_t n=0; n<list.size; n++) {
+        NU_Regrow_Children(ui_tree, *Vector_Get_Uint32(&list, n), 1, &list, &old_values);
+    }
+    for (uint32_t n=0; n<list.size; n++) {
+        NU_Replace_Children(ui_tree, *Vector_Get_Uint32(&list, n), &list, &old_values);
+    }
+
+    for (uint32_t n=0; n<list.size; n++) {
+        NU_Listed_Node(ui_tree, *Vector_Get_Uint32(&list, n))->dirty = 0;
+    }
+    Vector_Free(&list);
+    Vector_Free(&old_values);
+}
+
+// Parallel layout: a pool of worker threads runs the full layout's passes. Within a layer every parent's
+// children are a separate range, so the parents of a layer are claimed in chunks by the workers (and the
+// calling thread) and the next layer starts once all of them are done. The text passes split the text refs
+// the same way. Fontstash is not thread safe -> every worker measures and breaks text with its own font
+// context, the rows it breaks go to the text arena once the wrap pass is done. Window nodes are left to the
+// calling thread (SDL window calls are main thread only). The layout is identical to the serial one.
+#define NU_LAYOUT_MAX_THREADS 64
+#define NU_LAYOUT_MIN_PARALLEL_NODES 4096 // smaller passes run on the calling thread (waking the workers costs more)
+
+enum NU_Layout_Pass
+{
+    LAYOUT_PASS_CLEAR,          // parents of a layer -> children reset
+    LAYOUT_PASS_TEXT_FIT,       // text refs
+    LAYOUT_PASS_FIT_WIDTHS,     // parents of a layer, deepest layer first
+    LAYOUT_PASS_GROW_WIDTHS,    // parents of a layer
+    LAYOUT_PASS_TEXT_WRAP,      // text refs
+    LAYOUT_PASS_FIT_HEIGHTS,    // parents of a layer, deepest layer first
+    LAYOUT_PASS_GROW_HEIGHTS,   // parents of a layer
+    LAYOUT_PASS_POSITIONS       // parents of a layer
+};
+
+// Rows a worker broke for a text ref in the wrap pass
+struct NU_Broken_Text
+{
+    uint32_t text_ref_index;
+    uint32_t row_index;  // into the worker's rows
+    uint32_t row_count;
+    float width;
+};
+
+struct NU_Layout_Worker
+{
+    struct NU_Layout_Pool* pool;
+    NVGcontext* vg;         // measures text only, has the tree's fonts
+    struct Vector rows;     // struct Text_Row
+    struct Vector broken;   // struct NU_Broken_Text
+};
+
+struct NU_Layout_Pool
+{
+    struct NU_Layout_Worker workers[NU_LAYOUT_MAX_THREADS]; // workers[0] is the calling thread
+    SDL_Thread* threads[NU_LAYOUT_MAX_THREADS];
+    int thread_count;
+    uint32_t font_count; // fonts in the workers' font contexts (rebuilt when the tree's font count changes)
+    SDL_Mutex* mutex; // guards job, busy_workers and quit
+    SDL_Condition* job_ready;
+    SDL_Condition* job_done;
+    uint32_t job;     // incremented for every pass the workers join
+    int busy_workers;
+    int quit;
+
+    // The current pass
+    struct UI_Tree* ui_tree;
+    enum NU_Layout_Pass pass;
+    int layer;
+    uint32_t count;      // parents in the layer or text refs
+    uint32_t chunk_size;
+    SDL_AtomicInt next_chunk;
+    SDL_AtomicInt skipped_windows;
+};
+
+// A font context has no renderer, only the font atlas texture is ever created (and never drawn)
+static int NU_Font_Context_Create(void* user_ptr)
+{
+    return 1;
+}
+
+static int NU_Font_Context_Create_Texture(void* user_ptr, int type, int w, int h, int image_flags, const unsigned char* data)
+{
+    return 1;
+}
+
+static int NU_Font_Context_Delete_Texture(void* user_ptr, int image)
+{
+    return 1;
+}
 
-            NU_Horizontally_Place_Children(parent, child_layer);
-            NU_Vertically_Place_Children(parent, child_layer);
+// Creates a nanovg context that only measures text. The fonts are created in the same order as a window's
+// (see NU_Create_New_Window) so the font ids in the font registries are valid in it.
+static NVGcontext* NU_Create_Font_Context(struct UI_Tree* ui_tree)
+{
+    NVGparams params;
+    memset(&params, 0, sizeof(params));
+    params.renderCreate = NU_Font_Context_Create;
+    params.renderCreateTexture = NU_Font_Context_Create_Texture;
+    params.renderDeleteTexture = NU_Font_Context_Delete_Texture;
+    NVGcontext* vg = nvgCreateInternal(&params);
+    if (vg == NULL) return NULL;
+    for (int i=0; i<ui_tree->font_resources.size; i++) {
+        struct Font_Resource* font = Vector_Get(&ui_tree->font_resources, i);
+        nvgCreateFontMem(vg, font->name, font->data, font->size, 0);
+    }
+    return vg;
+}
+
+static void NU_Layout_Text_Chunk(struct NU_Layout_Worker* worker, uint32_t start, uint32_t end)
+{
+    struct NU_Layout_Pool* pool = worker->pool;
+    struct UI_Tree* ui_tree = pool->ui_tree;
+    struct Vector* font_registry = Vector_Get(&ui_tree->font_registries, 0);
+    int fontID = *(int*) Vector_Get(font_registry, 0);
+    for (uint32_t i=start; i<end; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, i);
+        struct Node* node = NU_Listed_Node(ui_tree, text_ref->node_ID);
+        if (pool->pass == LAYOUT_PASS_TEXT_FIT) {
+            NU_Calculate_Text_Fit_Size(ui_tree, node, worker->vg, text_ref);
+            continue;
         }
+        if (!Text_Can_Wrap(ui_tree, text_ref)) continue;
+
+        // Wrap as NU_Calculate_Text_Wrap_Height, new rows stay with the worker
+        float inner_width = node->width - node->border_left - node->border_right - node->pad_left - node->pad_right;
+        NU_Measure_Text(ui_tree, worker->vg, text_ref, fontID, NU_EM_PX);
+        uint32_t row_count = text_ref->row_count;
+        if (text_ref->break_width != inner_width)
+        {
+            struct NU_Broken_Text broken = { i, worker->rows.size, 0, inner_width };
+            nvgFontFaceId(worker->vg, fontID);
+            nvgFontSize(worker->vg, NU_EM_PX);
+            NU_Break_Text_Rows(worker->vg, NU_Text_Ref_Chars(ui_tree, text_ref), text_ref->char_count, inner_width, &worker->rows);
+            broken.row_count = worker->rows.size - broken.row_index;
+            Vector_Push(&worker->broken, &broken);
+            row_count = broken.row_count;
+        }
+        node->height = node->border_top + node->border_bottom + node->pad_top + node->pad_bottom + row_count * text_ref->line_height;
     }
 }
+
+static void NU_Layout_Parent_Chunk(struct NU_Layout_Worker* worker, uint32_t start, uint32_t end)
+{
+    struct NU_Layout_Pool* pool = worker->pool;
+    struct UI_Tree* ui_tree = pool->ui_tree;
+    int l = pool->layer;
+    struct Vector* child_layer = &ui_tree->tree_stack[l+1];
+    for (uint32_t p=start; p<end; p++)
+    {
+        struct Node* parent = Vector_Get_Node(&ui_tree->tree_stack[l], p);
+        switch (pool->pass)
+        {
+            case LAYOUT_PASS_CLEAR:
+                if (parent->tag == WINDOW && Vector_Get_Node_Cold(&ui_tree->cold_stack[l], p)->window == NULL) {
+                    SDL_AddAtomicInt(&pool->skipped_windows, 1); // needs a new window
+                    break;
+                }
+                NU_Clear_Children(ui_tree, l, p);
+                break;
+            case LAYOUT_PASS_FIT_WIDTHS:
+                if (parent->tag == WINDOW) {
+                    SDL_AddAtomicInt(&pool->skipped_windows, 1); // needs its window's size
+                    break;
+                }
+                NU_Fit_Node_Width(ui_tree, l, p);
+                break;
+            case LAYOUT_PASS_GROW_WIDTHS:
+                NU_Grow_Shrink_Child_Node_Widths(parent, child_layer);
+                break;
+            case LAYOUT_PASS_FIT_HEIGHTS:
+                NU_Fit_Node_Height(ui_tree, l, p);
+                break;
+            case LAYOUT_PASS_GROW_HEIGHTS:
+                NU_Grow_Shrink_Child_Node_Heights(parent, child_layer);
+                break;
+            default:
+                NU_Place_Children(parent, child_layer);
+                break;
+        }
+    }
+}
+
+// Claims chunks of the current pass until none are left
+static void NU_Layout_Claim_Chunks(struct NU_Layout_Worker* worker)
+{
+    struct NU_Layout_Pool* pool = worker->pool;
+    while (1)
+    {
+        uint32_t start = (uint32_t) SDL_AddAtomicInt(&pool->next_chunk, 1) * pool->chunk_size;
+        if (start >= pool->count) return;
+        uint32_t end = MIN(start + pool->chunk_size, pool->count);
+        if (pool->pass == LAYOUT_PASS_TEXT_FIT || pool->pass == LAYOUT_PASS_TEXT_WRAP) NU_Layout_Text_Chunk(worker, start, end);
+        else NU_Layout_Parent_Chunk(worker, start, end);
+    }
+}
+
+static int NU_Layout_Worker_Thread(void* data)
+{
+    struct NU_Layout_Worker* worker = (struct NU_Layout_Worker*) data;
+    struct NU_Layout_Pool* pool = worker->pool;
+    uint32_t job = 0;
+    SDL_LockMutex(pool->mutex);
+    while (1)
+    {
+        while (pool->job == job && !pool->quit) SDL_WaitCondition(pool->job_ready, pool->mutex);
+        if (pool->quit) break;
+        job = pool->job;
+        SDL_UnlockMutex(pool->mutex);
+        NU_Layout_Claim_Chunks(worker);
+        SDL_LockMutex(pool->mutex);
+        pool->busy_workers--;
+        if (pool->busy_workers == 0) SDL_SignalCondition(pool->job_done);
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return 0;
+}
+
+// Runs a pass over count parents of layer l (or count text refs) and returns once all of them are done.
+// work is the number of nodes the pass touches.
+static void NU_Layout_Run_Pass(struct NU_Layout_Pool* pool, enum NU_Layout_Pass pass, int l, uint32_t count, uint32_t work)
+{
+    pool->pass = pass;
+    pool->layer = l;
+    pool->count = count;
+    SDL_SetAtomicInt(&pool->next_chunk, 0);
+    SDL_SetAtomicInt(&pool->skipped_windows, 0);
+    if (pool->thread_count == 1 || work < NU_LAYOUT_MIN_PARALLEL_NODES)
+    {
+        pool->chunk_size = MAX(count, 1);
+        NU_Layout_Claim_Chunks(&pool->workers[0]);
+        return;
+    }
+
+    // Small chunks -> a worker that gets parents with many children doesn't hold up the others
+    pool->chunk_size = MAX(count / (pool->thread_count * 8), 1);
+    SDL_LockMutex(pool->mutex);
+    pool->job++;
+    pool->busy_workers = pool->thread_count - 1;
+    SDL_BroadcastCondition(pool->job_ready);
+    SDL_UnlockMutex(pool->mutex);
+    NU_Layout_Claim_Chunks(&pool->workers[0]);
+    SDL_LockMutex(pool->mutex);
+    while (pool->busy_workers > 0) SDL_WaitCondition(pool->job_done, pool->mutex);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+static void NU_Layout_Run_Layer(struct NU_Layout_Pool* pool, enum NU_Layout_Pass pass, int l)
+{
+    struct UI_Tree* ui_tree = pool->ui_tree;
+    NU_Layout_Run_Pass(pool, pass, l, ui_tree->tree_stack[l].size, ui_tree->tree_stack[l].size + ui_tree->tree_stack[l+1].size);
+}
+
+// Clears or fits the window nodes of layer l the workers skipped
+static void NU_Layout_Skipped_Windows(struct NU_Layout_Pool* pool, int l, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    struct UI_Tree* ui_tree = pool->ui_tree;
+    if (SDL_GetAtomicInt(&pool->skipped_windows) == 0) return;
+    for (uint32_t p=0; p<ui_tree->tree_stack[l].size; p++)
+    {
+        struct Node* parent = Vector_Get_Node(&ui_tree->tree_stack[l], p);
+        struct Node_Cold* parent_cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[l], p);
+        if (parent->tag != WINDOW) continue;
+        if (pool->pass == LAYOUT_PASS_FIT_WIDTHS) {
+            NU_Fit_Node_Width(ui_tree, l, p);
+            continue;
+        }
+        if (parent_cold->window != NULL) continue;
+        NU_Create_New_Window(ui_tree, parent_cold, windows, gl_contexts, nano_vg_contexts);
+        NU_Clear_Children(ui_tree, l, p);
+    }
+}
+
+// The text arena takes over the rows the workers broke
+static void NU_Layout_Store_Broken_Texts(struct NU_Layout_Pool* pool)
+{
+    struct Text_Arena* text_arena = &pool->ui_tree->text_arena;
+    for (int w=0; w<pool->thread_count; w++)
+    {
+        struct NU_Layout_Worker* worker = &pool->workers[w];
+        for (uint32_t i=0; i<worker->broken.size; i++)
+        {
+            struct NU_Broken_Text* broken = Vector_Get(&worker->broken, i);
+            NU_Compact_Text_Rows(text_arena);
+            uint32_t new_index = text_arena->rows.size;
+            Vector_Push_Range_Text_Row(&text_arena->rows, Vector_Get_Text_Row(&worker->rows, broken->row_index), broken->row_count);
+            NU_Store_Text_Rows(text_arena, Vector_Get_Text_Ref(&text_arena->text_refs, broken->text_ref_index), new_index, broken->width);
+        }
+        worker->rows.size = 0;
+        worker->broken.size = 0;
+    }
+}
+
+// Fonts pushed after NU_Layout_Pool_Init -> the workers' font contexts are rebuilt so their font ids match the
+// windows' font registries again. Runs while the workers wait for a pass. Fails (and keeps the old contexts)
+// if a context can't be created, the layout then runs on the calling thread.
+static int NU_Layout_Pool_Sync_Fonts(struct NU_Layout_Pool* pool, struct UI_Tree* ui_tree)
+{
+    if (pool->font_count == ui_tree->font_resources.size) return 0; // Success
+    NVGcontext* contexts[NU_LAYOUT_MAX_THREADS];
+    for (int w=0; w<pool->thread_count; w++)
+    {
+        contexts[w] = NU_Create_Font_Context(ui_tree);
+        if (contexts[w] == NULL)
+        {
+            printf("%s\n", "[Layout_Pool] Error! Could not rebuild a worker's font context");
+            for (int i=0; i<w; i++) nvgDeleteInternal(contexts[i]);
+            return -1; // Failure
+        }
+    }
+    for (int w=0; w<pool->thread_count; w++)
+    {
+        nvgDeleteInternal(pool->workers[w].vg);
+        pool->workers[w].vg = contexts[w];
+    }
+    pool->font_count = ui_tree->font_resources.size;
+    return 0; // Success
+}
+
+// The full layout (same passes as NU_Render's) on the pool
+static void NU_Layout_Parallel(struct NU_Layout_Pool* pool, struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    pool->ui_tree = ui_tree;
+    uint32_t text_ref_count = ui_tree->text_arena.text_refs.size;
+
+    for (int l=0; l<=ui_tree->deepest_layer; l++) {
+        NU_Layout_Run_Layer(pool, LAYOUT_PASS_CLEAR, l);
+        NU_Layout_Skipped_Windows(pool, l, windows, gl_contexts, nano_vg_contexts);
+    }
+    Vector_Get_Node(&ui_tree->tree_stack[0], 0)->dirty = 0;
+    NU_Layout_Run_Pass(pool, LAYOUT_PASS_TEXT_FIT, 0, text_ref_count, text_ref_count);
+
+    if (ui_tree->deepest_layer > 0)
+    {
+        for (int l=ui_tree->deepest_layer; l>=0; l--) {
+            NU_Layout_Run_Layer(pool, LAYOUT_PASS_FIT_WIDTHS, l);
+            NU_Layout_Skipped_Windows(pool, l, windows, gl_contexts, nano_vg_contexts);
+        }
+    }
+    for (int l=0; l<=ui_tree->deepest_layer; l++) NU_Layout_Run_Layer(pool, LAYOUT_PASS_GROW_WIDTHS, l);
+    NU_Layout_Run_Pass(pool, LAYOUT_PASS_TEXT_WRAP, 0, text_ref_count, text_ref_count);
+    NU_Layout_Store_Broken_Texts(pool);
+
+    if (ui_tree->deepest_layer > 0)
+    {
+        for (int l=ui_tree->deepest_layer; l>=0; l--) NU_Layout_Run_Layer(pool, LAYOUT_PASS_FIT_HEIGHTS, l);
+    }
+    for (int l=0; l<=ui_tree->deepest_layer; l++) NU_Layout_Run_Layer(pool, LAYOUT_PASS_GROW_HEIGHTS, l);
+    for (int l=0; l<=ui_tree->deepest_layer; l++) NU_Layout_Run_Layer(pool, LAYOUT_PASS_POSITIONS, l);
+}
+
+// Starts thread_count - 1 workers (<= 0 -> one thread per logical core, the calling thread is one of them)
+// and hands the tree's full layouts to them. The workers' font contexts copy the tree's fonts (and are rebuilt
+// when fonts are pushed later).
+int NU_Layout_Pool_Init(struct NU_Layout_Pool* pool, struct UI_Tree* ui_tree, int thread_count)
+{
+    if (thread_count <= 0) thread_count = SDL_GetNumLogicalCPUCores();
+    thread_count = MIN(MAX(thread_count, 1), NU_LAYOUT_MAX_THREADS);
+    pool->mutex = SDL_CreateMutex();
+    pool->job_ready = SDL_CreateCondition();
+    pool->job_done = SDL_CreateCondition();
+    if (pool->mutex == NULL || pool->job_ready == NULL || pool->job_done == NULL)
+    {
+        printf("%s %s\n", "[Layout_Pool] Error! Could not create the worker mutex:", SDL_GetError());
+        SDL_DestroyMutex(pool->mutex);
+        SDL_DestroyCondition(pool->job_ready);
+        SDL_DestroyCondition(pool->job_done);
+        return -1; // Failure
+    }
+    pool->job = 0;
+    pool->busy_workers = 0;
+    pool->quit = 0;
+    pool->ui_tree = ui_tree;
+    pool->font_count = ui_tree->font_resources.size;
+
+    // Fewer threads than asked for if a worker can't start
+    pool->thread_count = 0;
+    for (int w=0; w<thread_count; w++)
+    {
+        struct NU_Layout_Worker* worker = &pool->workers[w];
+        worker->pool = pool;
+        worker->vg = NU_Create_Font_Context(ui_tree);
+        if (worker->vg == NULL) break;
+        Vector_Reserve(&worker->rows, sizeof(struct Text_Row), 256);
+        Vector_Reserve(&worker->broken, sizeof(struct NU_Broken_Text), 64);
+        if (w > 0)
+        {
+            pool->threads[w] = SDL_CreateThread(NU_Layout_Worker_Thread, "NU_Layout_Worker", worker);
+            if (pool->threads[w] == NULL)
+            {
+                nvgDeleteInternal(worker->vg);
+                Vector_Free(&worker->rows);
+                Vector_Free(&worker->broken);
+                break;
+            }
+        }
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0)
+    {
+        printf("%s\n", "[Layout_Pool] Error! Could not create a font context");
+        SDL_DestroyMutex(pool->mutex);
+        SDL_DestroyCondition(pool->job_ready);
+        SDL_DestroyCondition(pool->job_done);
+        return -1; // Failure
+    }
+    ui_tree->layout_pool = pool;
+    return 0; // Success
+}
+
+// Stops the workers, the tree the pool is attached to (after a snapshot swap the front tree) lays out on the
+// calling thread again
+void NU_Layout_Pool_Close(struct NU_Layout_Pool* pool, struct UI_Tree* ui_tree)
+{
+    SDL_LockMutex(pool->mutex);
+    pool->quit = 1;
+    SDL_BroadcastCondition(pool->job_ready);
+    SDL_UnlockMutex(pool->mutex);
+    for (int w=1; w<pool->thread_count; w++) {
+        SDL_WaitThread(pool->threads[w], NULL);
+    }
+    for (int w=0; w<pool->thread_count; w++)
+    {
+        nvgDeleteInternal(pool->workers[w].vg);
+        Vector_Free(&pool->workers[w].rows);
+        Vector_Free(&pool->workers[w].broken);
+    }
+    SDL_DestroyMutex(pool->mutex);
+    SDL_DestroyCondition(pool->job_ready);
+    SDL_DestroyCondition(pool->job_done);
+    ui_tree->layout_pool = NULL;
+}
 // UI layout ------------------------------------------------------------
 
 
 
 // UI rendering ---------------------------------------------------------
-void NU_Draw_Node(struct Node* node, NVGcontext* vg, float screen_width, float screen_height)
+void NU_Draw_Node(struct Node* node, struct Node_Cold* cold, NVGcontext* vg, float screen_width, float screen_height)
 {
     float inner_width  = node->width - node->border_left - node->border_right - node->pad_left - node->pad_right;
     float inner_height = node->height - node->border_top - node->border_bottom - node->pad_top - node->pad_bottom;
@@ -674,10 +1391,10 @@ void NU_Draw_Node(struct Node* node, NVGcontext* vg, float screen_width, float s
         node->border_bottom,
         node->border_left,
         node->border_right,
-        node->border_radius_tl,
-        node->border_radius_tr,
-        node->border_radius_bl,
-        node->border_radius_br, 
+        cold->border_radius_tl,
+        cold->border_radius_tr,
+        cold->border_radius_bl,
+        cold->border_radius_br, 
         (char)120, (char)140, (char)30,
         screen_width,
         screen_height
@@ -730,20 +1447,20 @@ void NU_Draw_Node(struct Node* node, NVGcontext* vg, float screen_width, float s
 //     nvgText(vg, floorf(textPosX), floorf(textPosY), text, NULL);
 // }
 
-void NU_Draw_Node_Text(struct UI_Tree* ui_tree, struct Node* node, char* text, NVGcontext* vg)
+void NU_Draw_Node_Text(struct UI_Tree* ui_tree, struct Node* node, struct Text_Ref* text_ref, NVGcontext* vg)
 {
     // Setup font
     struct Vector* font_registry = Vector_Get(&ui_tree->font_registries, 0);
     int fontID = *(int*) Vector_Get(font_registry, 0);
     nvgFontFaceId(vg, fontID);   
-    nvgFontSize(vg, 18);
+    nvgFontSize(vg, NU_EM_PX);
 
     // Text color and alignment
     nvgFillColor(vg, nvgRGB(255, 255, 255));
     nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
 
     float asc, desc, lh;
-    nvgTextMetrics(node->vg, &asc, &desc, &lh);
+    nvgTextMetrics(vg, &asc, &desc, &lh);
 
     // Compute inner dimensions (content area)
     float inner_width  = node->width  - node->border_left - node->border_right - node->pad_left - node->pad_right;
@@ -753,30 +1470,38 @@ void NU_Draw_Node_Text(struct UI_Tree* ui_tree, struct Node* node, char* text, N
     float textPosX = node->x + node->border_left + node->pad_left;
     float textPosY = node->y + node->border_top  + node->pad_top - desc * 0.5f;
 
-    // Draw wrapped text inside inner_width
-    nvgTextBox(vg, floorf(textPosX), floorf(textPosY), inner_width, text, NULL);
+    // Draw the text's rows broken at inner_width (the rows layout broke the text into unless the width changed)
+    NU_Break_Text(ui_tree, vg, text_ref, fontID, NU_EM_PX, inner_width);
+    char* text = NU_Text_Ref_Chars(ui_tree, text_ref);
+    float row_y = floorf(textPosY);
+    for (uint32_t i=0; i<text_ref->row_count; i++)
+    {
+        struct Text_Row* row = Vector_Get_Text_Row(&ui_tree->text_arena.rows, text_ref->row_index + i);
+        nvgText(vg, floorf(textPosX), row_y, text + row->start, text + row->end);
+        row_y += lh;
+    }
 }
 
 void NU_Draw_Nodes(struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
 {
     struct Vector window_nodes_list[MAX_TREE_DEPTH];
     for (int i=0; i<windows->size; i++) {
-        Vector_Reserve(&window_nodes_list[i], sizeof(struct Node*), 1000);
+        Vector_Reserve(&window_nodes_list[i], sizeof(struct Node_Cold*), 1000);
     }
 
     // For each layer
     for (int l=0; l<=ui_tree->deepest_layer; l++)
     {
-        struct Vector* layer = &ui_tree->tree_stack[l];
-        for (int n=0; n<layer->size; n++)
+        struct Vector* cold_layer = &ui_tree->cold_stack[l];
+        for (int n=0; n<cold_layer->size; n++)
         {   
-            struct Node* node = Vector_Get(layer, n);
+            struct Node_Cold* cold = Vector_Get_Node_Cold(cold_layer, n);
             for (int i=0; i<windows->size; i++)
             {
                 SDL_Window* window = *(SDL_Window**) Vector_Get(windows, i);
-                if (window == node->window)
+                if (window == cold->window)
                 {
-                    Vector_Push(&window_nodes_list[i], &node);
+                    Vector_Push(&window_nodes_list[i], &cold);
                 }
             }
         }
@@ -803,19 +1528,15 @@ void NU_Draw_Nodes(struct UI_Tree* ui_tree, struct Vector* windows, struct Vecto
         // For each node belonging to the window
         for (int n=0; n<window_nodes_list[i].size; n++)
         {
-            struct Node* node = *(struct Node**) Vector_Get(&window_nodes_list[i], n);
+            struct Node_Cold* cold = *(struct Node_Cold**) Vector_Get(&window_nodes_list[i], n);
+            struct Node* node = Vector_Get_Node(&ui_tree->tree_stack[cold->ID >> 24], cold->ID & 0x00FFFFFF);
 
-            NU_Draw_Node(node, nano_vg_context, (float)w, (float)h);
+            NU_Draw_Node(node, cold, nano_vg_context, (float)w, (float)h);
 
-            if (node->text_ref_index != -1)
+            if (cold->text_ref_index != -1)
             {
-                struct Text_Ref* text_ref = (struct Text_Ref*) Vector_Get(&ui_tree->text_arena.text_refs, node->text_ref_index);
-                
-                // Extract pointer to text
-                char* text = ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
-                if (text_ref->char_count != text_ref->char_capacity) text[text_ref->char_count] = '\0';
-                NU_Draw_Node_Text(ui_tree, node, text, nano_vg_context);
-                if (text_ref->char_count != text_ref->char_capacity) text[text_ref->char_count] = ' ';
+                struct Text_Ref* text_ref = Vector_Get_Text_Ref(&ui_tree->text_arena.text_refs, cold->text_ref_index);
+                NU_Draw_Node_Text(ui_tree, node, text_ref, nano_vg_context);
             }
         }
 
@@ -836,16 +1557,36 @@ void NU_Draw_Nodes(struct UI_Tree* ui_tree, struct Vector* windows, struct Vecto
     }
 }
 
+// Lays out the tree (the whole tree when it is new or the window was resized, on the tree's layout pool if it
+// has one, otherwise only what was marked dirty since the last frame) and draws it
 void NU_Render(struct UI_Tree* ui_tree, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
 {
-    NU_Clear_Node_Sizes(ui_tree, windows, gl_contexts, nano_vg_contexts);
-    NU_Calculate_Text_Fit_Sizes(ui_tree);
-    NU_Calculate_Fit_Size_Widths(ui_tree);
-    NU_Grow_Shrink_Widths(ui_tree);
-    NU_Calculate_Text_Wrap_Heights(ui_tree, windows, gl_contexts, nano_vg_contexts);
-    NU_Calculate_Fit_Size_Heights(ui_tree);
-    NU_Grow_Shrink_Heights(ui_tree);
-    NU_Calculate_Positions(ui_tree);
+    struct Node* root = Vector_Get_Node(&ui_tree->tree_stack[0], 0);
+    struct Node_Cold* root_cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[0], 0);
+    if (root_cold->window != NULL)
+    {
+        int window_width, window_height;
+        SDL_GetWindowSize(root_cold->window, &window_width, &window_height);
+        if ((float) window_width != root->width || (float) window_height != root->height) root->dirty |= NU_DIRTY_ALL;
+    }
+
+    if ((root->dirty & NU_DIRTY_ALL) && ui_tree->layout_pool != NULL && NU_Layout_Pool_Sync_Fonts(ui_tree->layout_pool, ui_tree) == 0) {
+        NU_Layout_Parallel(ui_tree->layout_pool, ui_tree, windows, gl_contexts, nano_vg_contexts);
+    }
+    else if (root->dirty & NU_DIRTY_ALL)
+    {
+        NU_Clear_Node_Sizes(ui_tree, windows, gl_contexts, nano_vg_contexts);
+        NU_Calculate_Text_Fit_Sizes(ui_tree);
+        NU_Calculate_Fit_Size_Widths(ui_tree);
+        NU_Grow_Shrink_Widths(ui_tree);
+        NU_Calculate_Text_Wrap_Heights(ui_tree, windows, gl_contexts, nano_vg_contexts);
+        NU_Calculate_Fit_Size_Heights(ui_tree);
+        NU_Grow_Shrink_Heights(ui_tree);
+        NU_Calculate_Positions(ui_tree);
+    }
+    else if (root->dirty) {
+        NU_Layout_Dirty_Nodes(ui_tree, windows, gl_contexts, nano_vg_contexts);
+    }
     NU_Draw_Nodes(ui_tree, windows, gl_contexts, nano_vg_contexts);
 }
 // UI rendering ---------------------------------------------------------
@@ -866,6 +1607,7 @@ bool ResizingEventWatcher(void* data, SDL_Event* event)
 
     if (event->type == SDL_EVENT_WINDOW_RESIZED) 
     {
+        NU_Mark_Tree_Dirty(wd->ui_tree);
         NU_Render(wd->ui_tree, wd->windows, wd->gl_contexts, wd->nano_vg_contexts);
     }
     return true;
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+#include "file_map.h"
+
+// Parallel parse: the root window is parsed serially, its direct children are split into contiguous groups
+// (one per thread) that are tokenised and built on worker threads, then the groups are spliced into the tree.
+#define NU_PARALLEL_MAX_THREADS 64
+#define NU_PARALLEL_MIN_BYTES 65536 // smaller sources are parsed serially (thread start up costs more than it saves)
+
+struct NU_Parse_Group
+{
+    char* src_buffer;
+    uint32_t start;
+    uint32_t end;
+    struct UI_Tree tree;  // private layers, tree.tree_stack[0] holds a stand-in for the root window
+    int result;           // 0 == success, -1 == grammar error, 1 == the group can't be parsed on its own
+
+    // Where the group lands in the final tree (set once every group is built)
+    struct UI_Tree* ui_tree;
+    uint32_t layer_offsets[MAX_TREE_DEPTH + 1];
+    uint32_t text_ref_offset;
+    uint32_t char_offset;
+    uint32_t id_char_offset;
+};
+
+// Finds where the root window's content starts/ends and where each of its direct children begins.
+// Only structure is scanned (tags, quoted values and comments). Returns -1 if the structure is unclear,
+// the serial parser then handles the document (and reports any errors).
+static int NU_Prescan_Root_Children(char* src, uint32_t length, uint32_t* content_start, uint32_t* content_end, struct Vector* child_starts)
+{
+    int depth = 0;
+    uint32_t i = 0;
+    while (1)
+    {
+        i = Scan_Until(src, i, length, SCAN_OPEN);
+        if (i == length) return -1; // root never closed
+
+        // Comment -> skip to "-->"
+        if (i + 3 < length && src[i+1] == '!' && src[i+2] == '-' && src[i+3] == '-')
+        {
+            i+=4;
+            while (1) {
+                i = Scan_Until(src, i, length, SCAN_COMMENT);
+                if (i + 2 >= length) return -1;
+                if (src[i+1] == '-' && src[i+2] == '>') break;
+                i+=1;
+            }
+            i+=3;
+            continue;
+        }
+
+        // End tag -> the root's end tag closes its content
+        if (i + 1 < length && src[i+1] == '/')
+        {
+            depth--;
+            if (depth < 0) return -1;
+            if (depth == 0) {
+                *content_end = i;
+                return 0; // Success
+            }
+            i+=2;
+            continue;
+        }
+
+        // Opening tag -> skip over property values to the closing '>'
+        if (depth == 1) Vector_Push(child_starts, &i);
+        uint32_t j = i + 1;
+        while (1)
+        {
+            j = Scan_Until(src, j, length, SCAN_CLOSE);
+            if (j == length) return -1;
+            if (src[j] == '>') break;
+            j = Scan_Until(src, j + 1, length, SCAN_QUOTE);
+            if (j == length) return -1;
+            j+=1;
+        }
+        if (src[j-1] != '/') // not self closing
+        {
+            depth++;
+            if (depth == 1) *content_start = j + 1;
+        }
+        else if (depth == 0) return -1; // self closing root
+        i = j + 1;
+    }
+}
+
+static int NU_Parse_Group_Thread(void* data)
+{
+    struct NU_Parse_Group* group = (struct NU_Parse_Group*) data;
+    struct NU_Parser parser;
+    NU_Parser_Init(&parser, &group->tree, group->end - group->start);
+    parser.src_persistent = 1;
+    parser.src_offset = group->start;
+
+    // Stand in root -> the group's nodes land in the same layers they will have in the final tree
+    NU_Parser_Open_Node(&parser, WINDOW);
+    parser.grammar = GRAMMAR_CONTENT;
+
+    uint32_t consumed;
+    group->result = NU_Tokenise(group->src_buffer + group->start, group->end - group->start, &parser, 1, &consumed);
+    Vector_Free(&parser.carry);
+    if (group->result != 0) return 0;
+
+    // Text directly inside the root or an unclosed child -> leave the document to the serial parser
+    struct Node_Cold* stand_in_root = Vector_Get(&group->tree.cold_stack[0], 0);
+    if (parser.current_layer != 0 || parser.ctx != 0 || parser.text_char_count > 0 || stand_in_root->text_ref_index != -1) {
+        group->result = 1;
+    }
+    return 0;
+}
+
+static void NU_Free_Parse_Group(struct NU_Parse_Group* group)
+{
+    NU_Free_UI_Tree_Memory(&group->tree);
+}
+
+// Copies a group into its slice of the (already sized) tree layers and fixes up indices and node IDs
+static int NU_Splice_Group_Thread(void* data)
+{
+    struct NU_Parse_Group* group = (struct NU_Parse_Group*) data;
+    struct UI_Tree* ui_tree = group->ui_tree;
+    struct UI_Tree* group_tree = &group->tree;
+    uint32_t* layer_offsets = group->layer_offsets;
+
+    // Nodes
+    for (int l=1; l<=group_tree->deepest_layer; l++)
+    {
+        struct Vector* group_layer = &group_tree->tree_stack[l];
+        struct Node* nodes = Vector_Get(&ui_tree->tree_stack[l], layer_offsets[l]);
+        struct Node_Cold* colds = Vector_Get(&ui_tree->cold_stack[l], layer_offsets[l]);
+        memcpy(nodes, group_layer->data, group_layer->size * sizeof(struct Node));
+        memcpy(colds, group_tree->cold_stack[l].data, group_layer->size * sizeof(struct Node_Cold));
+        for (uint32_t n=0; n<group_layer->size; n++)
+        {
+            struct Node* node = &nodes[n];
+            node->parent_index += layer_offsets[l-1];
+            if (node->first_child_index != -1) node->first_child_index += layer_offsets[l+1];
+        }
+        for (uint32_t n=0; n<group_layer->size; n++)
+        {
+            struct Node_Cold* cold = &colds[n];
+            cold->ID = ((uint32_t) l << 24) | ((layer_offsets[l] + n) & 0xFFFFFF);
+            if (cold->text_ref_index != -1) cold->text_ref_index += group->text_ref_offset;
+            if (cold->id_index != -1) cold->id_index += group->id_char_offset;
+            cold->handle_index = -1; // the group's handles are dropped, ids get final ones once every group is in
+        }
+    }
+
+    // Text
+    struct Vector* group_text_refs = &group_tree->text_arena.text_refs;
+    struct Vector* group_chars = &group_tree->text_arena.char_buffer;
+    memcpy(Vector_Get(&ui_tree->text_arena.char_buffer, group->char_offset), group_chars->data, group_chars->size);
+    memcpy(Vector_Get(&ui_tree->id_chars, group->id_char_offset), group_tree->id_chars.data, group_tree->id_chars.size);
+    struct Text_Ref* text_refs = Vector_Get(&ui_tree->text_arena.text_refs, group->text_ref_offset);
+    memcpy(text_refs, group_text_refs->data, group_text_refs->size * sizeof(struct Text_Ref));
+    for (uint32_t t=0; t<group_text_refs->size; t++)
+    {
+        struct Text_Ref* text_ref = &text_refs[t];
+        uint32_t layer = text_ref->node_ID >> 24;
+        text_ref->node_ID = (layer << 24) | (((text_ref->node_ID & 0xFFFFFF) + layer_offsets[layer]) & 0xFFFFFF);
+        if (!text_ref->in_source) text_ref->buffer_index += group->char_offset;
+    }
+    return 0;
+}
+
+static void NU_Swap_Vectors(struct Vector* a, struct Vector* b)
+{
+    struct Vector temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Appends every group's layers and text to the tree. Every group's slice is known once all groups are built
+// so the copies and fix ups run in parallel too.
+static void NU_Splice_Parse_Groups(struct UI_Tree* ui_tree, struct NU_Parse_Group* groups, int group_count)
+{
+    // Offsets of each group's slice (every group's stand in root maps onto the real root)
+    struct Node* root = Vector_Get(&ui_tree->tree_stack[0], 0);
+    struct Node_Cold* root_cold = Vector_Get(&ui_tree->cold_stack[0], 0);
+    uint32_t layer_sizes[MAX_TREE_DEPTH + 1] = { 0 };
+    uint32_t text_ref_count = 0;
+    uint32_t char_count = 0;
+    uint32_t id_char_count = 0;
+    for (int g=0; g<group_count; g++)
+    {
+        struct UI_Tree* group_tree = &groups[g].tree;
+        groups[g].ui_tree = ui_tree;
+        groups[g].layer_offsets[0] = 0;
+        for (int l=1; l<=MAX_TREE_DEPTH; l++) {
+            groups[g].layer_offsets[l] = layer_sizes[l];
+            if (l <= group_tree->deepest_layer) layer_sizes[l] += group_tree->tree_stack[l].size;
+        }
+        groups[g].text_ref_offset = text_ref_count;
+        groups[g].char_offset = char_count;
+        groups[g].id_char_offset = id_char_count;
+        text_ref_count += group_tree->text_arena.text_refs.size;
+        char_count += group_tree->text_arena.char_buffer.size;
+        id_char_count += group_tree->id_chars.size;
+        ui_tree->deepest_layer = MAX(ui_tree->deepest_layer, group_tree->deepest_layer);
+
+        // Root children
+        struct Node* stand_in_root = Vector_Get(&group_tree->tree_stack[0], 0);
+        struct Node_Cold* stand_in_root_cold = Vector_Get(&group_tree->cold_stack[0], 0);
+        if (root->child_count == 0 && stand_in_root->child_count > 0) root->first_child_index = 0;
+        root->child_count += stand_in_root->child_count;
+        root_cold->child_capacity += stand_in_root_cold->child_capacity;
+    }
+
+    // The first group's nodes and text are already at their final indices -> its vectors are adopted and grown
+    struct UI_Tree* first_tree = &groups[0].tree;
+    NU_Reserve_Layers(ui_tree, ui_tree->deepest_layer + 2);
+    NU_Reserve_Layers(first_tree, ui_tree->deepest_layer + 2);
+    for (int l=1; l<=ui_tree->deepest_layer; l++) {
+        NU_Swap_Vectors(&ui_tree->tree_stack[l], &first_tree->tree_stack[l]);
+        NU_Swap_Vectors(&ui_tree->cold_stack[l], &first_tree->cold_stack[l]);
+    }
+    NU_Swap_Vectors(&ui_tree->text_arena.text_refs, &first_tree->text_arena.text_refs);
+    NU_Swap_Vectors(&ui_tree->text_arena.char_buffer, &first_tree->text_arena.char_buffer);
+
+    // Its handles are adopted too. The root's id moves behind the groups' ids and the root gets a new handle.
+    struct Vector* root_id_chars = &first_tree->id_chars;
+    NU_Swap_Vectors(&ui_tree->id_chars, root_id_chars);
+    NU_Swap_Vectors(&ui_tree->handles, &first_tree->handles);
+    ui_tree->free_handle = first_tree->free_handle;
+    root_cold->handle_index = -1;
+
+    // The adopted vectors live in the first group's region -> the tree takes over its chunks
+    Region_Adopt(&ui_tree->region, &first_tree->region);
+    for (int l=1; l<=ui_tree->deepest_layer; l++) {
+        ui_tree->tree_stack[l].region = &ui_tree->region;
+        ui_tree->cold_stack[l].region = &ui_tree->region;
+    }
+    ui_tree->text_arena.text_refs.region = &ui_tree->region;
+    ui_tree->text_arena.char_buffer.region = &ui_tree->region;
+    ui_tree->id_chars.region = &ui_tree->region;
+    ui_tree->handles.region = &ui_tree->region;
+
+    for (int l=1; l<=ui_tree->deepest_layer; l++) {
+        Vector_Resize(&ui_tree->tree_stack[l], layer_sizes[l]);
+        Vector_Resize(&ui_tree->cold_stack[l], layer_sizes[l]);
+    }
+    Vector_Resize(&ui_tree->text_arena.text_refs, text_ref_count);
+    Vector_Resize(&ui_tree->text_arena.char_buffer, char_count);
+    Vector_Resize(&ui_tree->id_chars, id_char_count + root_id_chars->size);
+    memcpy(Vector_Get(&ui_tree->id_chars, id_char_count), root_id_chars->data, root_id_chars->size);
+    if (root_cold->id_index != -1) root_cold->id_index += id_char_count;
+
+    SDL_Thread* threads[NU_PARALLEL_MAX_THREADS];
+    for (int g=2; g<group_count; g++) {
+        threads[g] = SDL_CreateThread(NU_Splice_Group_Thread, "NU_Splice_Group", &groups[g]);
+        if (threads[g] == NULL) NU_Splice_Group_Thread(&groups[g]);
+    }
+    NU_Splice_Group_Thread(&groups[1]);
+    for (int g=2; g<group_count; g++) {
+        if (threads[g] != NULL) SDL_WaitThread(threads[g], NULL);
+    }
+    NU_Rebuild_Id_Table(ui_tree); // one table in document order -> serial, and only walks the tree if there are ids
+}
+
+// Parses the XML source on up to thread_count threads (<= 0 -> one per logical core). The tree is identical to NU_Parse.
+int NU_Parse_Parallel(char* filepath, struct UI_Tree* ui_tree, int thread_count)
+{
+    struct File_Map src_file;
+    if (File_Map_Open(filepath, &src_file) != 0) {
+        return -1;
+    }
+    char* src_buffer = src_file.data;
+    uint32_t src_length = src_file.length;
+
+    if (thread_count <= 0) thread_count = SDL_GetNumLogicalCPUCores();
+    thread_count = MIN(thread_count, NU_PARALLEL_MAX_THREADS);
+
+    // Find the root's children
+    uint32_t content_start = 0;
+    uint32_t content_end = 0;
+    struct Vector child_starts;
+    Vector_Reserve(&child_starts, sizeof(uint32_t), 256);
+    int prescan_result = -1;
+    if (thread_count > 1 && src_length >= NU_PARALLEL_MIN_BYTES) {
+        prescan_result = NU_Prescan_Root_Children(src_buffer, src_length, &content_start, &content_end, &child_starts);
+    }
+    int group_count = MIN(thread_count, (int) child_starts.size);
+    if (prescan_result != 0 || group_count < 2 || child_starts.size > UINT16_MAX) // too many root children -> the serial parser reports it
+    {
+        Vector_Free(&child_starts);
+        if (NU_Parse_Source(src_buffer, src_length, ui_tree) != 0) {
+            File_Map_Close(&src_file);
+            return -1; // Failure
+        }
+        ui_tree->src_file = src_file;
+        return 0; // Success
+    }
+
+    // Split the root's content into groups of whole children with roughly equal byte counts
+    struct NU_Parse_Group groups[NU_PARALLEL_MAX_THREADS];
+    uint32_t content_length = content_end - content_start;
+    uint32_t child = 0;
+    for (int g=0; g<group_count; g++)
+    {
+        groups[g].src_buffer = src_buffer;
+        groups[g].start = (g == 0) ? content_start : groups[g-1].end;
+        uint32_t target = content_start + (uint32_t) (((uint64_t) content_length * (g + 1)) / group_count);
+        if (g == group_count - 1) {
+            groups[g].end = content_end;
+            continue;
+        }
+        child++; // every group gets at least one child
+        while (child < child_starts.size - (group_count - g - 2) - 1 && *(uint32_t*) Vector_Get(&child_starts, child) < target) child++;
+        groups[g].end = *(uint32_t*) Vector_Get(&child_starts, child);
+    }
+    Vector_Free(&child_starts);
+
+    // Build the groups on worker threads (the calling thread takes the first group)
+    SDL_Thread* threads[NU_PARALLEL_MAX_THREADS];
+    for (int g=1; g<group_count; g++) {
+        threads[g] = SDL_CreateThread(NU_Parse_Group_Thread, "NU_Parse_Group", &groups[g]);
+        if (threads[g] == NULL) NU_Parse_Group_Thread(&groups[g]);
+    }
+    NU_Parse_Group_Thread(&groups[0]);
+    int group_result = 0;
+    for (int g=0; g<group_count; g++) {
+        if (g > 0 && threads[g] != NULL) SDL_WaitThread(threads[g], NULL);
+        if (groups[g].result != 0 && group_result != -1) group_result = groups[g].result;
+    }
+
+    // Grammar error -> already reported by the worker. Anything else the groups can't express -> parse serially
+    if (group_result != 0)
+    {
+        for (int g=0; g<group_count; g++) NU_Free_Parse_Group(&groups[g]);
+        if (group_result == -1 || NU_Parse_Source(src_buffer, src_length, ui_tree) != 0) {
+            File_Map_Close(&src_file);
+            return -1; // Failure
+        }
+        ui_tree->src_file = src_file;
+        return 0; // Success
+    }
+
+    // Root open tag, spliced children, then the root end tag and anything after it
+    struct NU_Parser parser;
+    NU_Parser_Init(&parser, ui_tree, 0); // the groups' memory is adopted, the tree itself only holds the root
+    parser.src_persistent = 1;
+    uint32_t consumed;
+    int result = NU_Tokenise(src_buffer, content_start, &parser, 0, &consumed);
+    if (result == 0)
+    {
+        NU_Splice_Parse_Groups(ui_tree, groups, group_count);
+        parser.src_offset = content_end;
+        result = NU_Tokenise(src_buffer + content_end, src_length - content_end, &parser, 1, &consumed);
+    }
+    for (int g=0; g<group_count; g++) NU_Free_Parse_Group(&groups[g]);
+    if (result != 0) parser.grammar = GRAMMAR_ERROR;
+    if (NU_Parser_Finish(&parser) != 0)
+    {
+        File_Map_Close(&src_file);
+        return -1; // Failure
+    }
+    ui_tree->src_file = src_file;
+    return 0; // Success
+}
@@ -1,6 +1,7 @@
 #pragma once
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
-#define MAX_TREE_DEPTH 32
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX_TREE_DEPTH 256 // the layer is the top 8 bits of a node ID
 
 // Layout flag bits
 #define LAYOUT_HORIZONTAL            0x00        // 0b00000000
@@ -10,6 +11,21 @@
 #define OVERFLOW_VERTICAL_SCROLL     0x08        // 0b00001000
 #define OVERFLOW_HORIZONTAL_SCROLL   0x10        // 0b00010000
 
+// Size units (em is resolved to px while parsing)
+#define UNIT_PX                      0
+#define UNIT_PERCENT                 1           // of the parent's content size, resolved when growing
+#define UNIT_FR                      2           // share of the parent's free space, resolved when growing
+#define NU_EM_PX                     18.0f       // matches the font size layout measures text with
+
+// Dirty bits (NU_Render only lays out what changed since the last frame, see NU_Mark_Node_Dirty)
+#define NU_DIRTY_SELF                0x01        // the node's text, size properties or child list changed
+#define NU_DIRTY_CHILD               0x02        // a node below it is dirty
+#define NU_DIRTY_ALL                 0x04        // new node, on the root -> the whole tree is laid out
+#define NU_DIRTY_LISTED              0x08        // in the current frame's list of nodes to lay out
+
+// Streaming parse: longest word, property value or tag opener carried between chunks (longer -> parse error)
+#define NU_MAX_CARRY                 65536
+
 #include <SDL3/SDL.h>
 #include <GL/glew.h>
 #include <stdint.h>
@@ -18,6 +34,8 @@
 #include <string.h>
 #include "performance.h"
 #include "vector.h"
+#include "scan.h"
+#include "file_map.h"
 
 #define NANOVG_GL3_IMPLEMENTATION
 #include <nanovg.h>
@@ -48,6 +66,7 @@ const char* keywords[] = {
     "image"
 };
 const uint8_t keyword_lengths[] = { 2, 3, 4, 9, 9, 5, 8, 8, 6, 9, 9, 6, 6, 6, 4, 6, 4, 4, 5 };
+
 enum NU_Token
 {
     ID_PROPERTY,
@@ -78,6 +97,19 @@ enum NU_Token
     TEXT_CONTENT,
     UNDEFINED
 };
+enum NU_Grammar
+{
+    GRAMMAR_ROOT,           // expecting the root <window>
+    GRAMMAR_TAG_NAME,       // after '<'
+    GRAMMAR_TAG,            // inside an opening tag -> property | '>' | '/>'
+    GRAMMAR_ASSIGNMENT,     // after a property name
+    GRAMMAR_VALUE,          // after '='
+    GRAMMAR_CONTENT,        // between tags -> text | '<' | '</'
+    GRAMMAR_END_TAG_NAME,   // after '</'
+    GRAMMAR_END_TAG_CLOSE,  // after '</name'
+    GRAMMAR_DONE,           // root closed
+    GRAMMAR_ERROR           // a grammar rule failed, the parse is abandoned
+};
 enum Tag
 {
     WINDOW,
@@ -99,50 +131,111 @@ struct Text_Ref
     uint32_t buffer_index;
     uint32_t char_count;
     uint32_t char_capacity; // excludes the null terminator
+    uint8_t in_source;      // 1 == buffer_index points into the (read only) src file, 0 == into the text arena
+
+    // Measurement cache (see NU_Measure_Text), valid while the text is unchanged and the font matches
+    int measured_font;      // -1 == not measured
+    float measured_size;
+    float text_width, word_width, line_height;
+
+    // Line break cache (see NU_Break_Text), rows of the measured text broken at break_width
+    float break_width;      // -1 == not broken
+    uint32_t row_index;     // first row in the text arena's rows
+    uint32_t row_count, row_capacity;
 };
 
+// A line of a broken text (offsets into the text)
+struct Text_Row
+{
+    uint32_t start, end;
+    float width;
+};
+
+// Layout critical node fields. Layers store these packed together so the layout passes stream as little memory as possible.
 struct Node
 {
-    SDL_Window* window;
-    NVGcontext* vg;
-    uint32_t ID;
-    enum Tag tag;
     float x, y, width, height, preferred_width, preferred_height;
     float min_width, max_width, min_height, max_height;
-    float gap, content_width, content_height;
+    float gap, fit_width, fit_height; // size before growing (kept so a clean node needs no new fit pass)
     int parent_index;
     int first_child_index;
-    int text_ref_index;
-    uint16_t child_capacity;
     uint16_t child_count;
     uint16_t pad_top, pad_bottom, pad_left, pad_right;
     uint16_t border_top, border_bottom, border_left, border_right;
-    uint16_t border_radius_tl, border_radius_tr, border_radius_bl, border_radius_br;
-    char background_r, background_g, background_b, background_a;
-    char border_r, border_g, border_b, border_a;
+    uint8_t tag;
     char layout_flags;
+    uint8_t width_unit, height_unit;
     char horizontal_alignment;
     char vertical_alignment;
+    uint8_t dirty;
 };
 
-struct Property_Text_Ref
+// Node fields only needed when creating windows, drawing or editing the tree (parallel layers, same index as the node)
+struct Node_Cold
 {
-    uint32_t NU_Token_index;
-    uint32_t src_index;
-    uint8_t char_count;
+    SDL_Window* window;
+    NVGcontext* vg;
+    uint32_t ID;
+    int text_ref_index;
+    int handle_index; // slot in the handle table, -1 until a handle is asked for (see tree_edit.h)
+    int id_index;     // start of the node's id in the tree's id_chars, -1 if it has none
+    uint16_t child_capacity;
+    uint16_t border_radius_tl, border_radius_tr, border_radius_bl, border_radius_br;
+    char background_r, background_g, background_b, background_a;
+    char border_r, border_g, border_b, border_a;
 };
 
+VECTOR_DEFINE(Text_Ref, struct Text_Ref)
+VECTOR_DEFINE(Text_Row, struct Text_Row)
+VECTOR_DEFINE(Node, struct Node)
+VECTOR_DEFINE(Node_Cold, struct Node_Cold)
+
 struct Arena_Free_Element
 {
     uint32_t index;
     uint32_t length;
 };
 
+// Generational handle: stays valid while the node moves around its layer, goes stale when the node is removed
+struct Node_Handle
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+struct Node_Handle_Slot
+{
+    uint32_t node_ID;    // where the node is now (next free slot while the slot is free)
+    uint32_t generation; // bumped when the node is removed
+};
+
+// Entry of the id table (open addressing, linear probing). Maps an id to the handle of the node that has it.
+struct Id_Slot
+{
+    uint32_t hash;
+    uint32_t char_index; // start of the id in id_chars, UINT32_MAX == empty slot
+    struct Node_Handle handle;
+};
+
+// Run of dead node slots in a layer that no parent owns (left behind by removed subtrees, see tree_edit.h)
+struct Layer_Free_Run
+{
+    uint32_t index;
+    uint32_t length;
+};
+
+#define NU_TEXT_SIZE_CLASSES 32
+
 struct Text_Arena
 {
-    struct Vector free_list;
+    struct Vector free_lists[NU_TEXT_SIZE_CLASSES]; // struct Arena_Free_Element, one list per size class
+    uint32_t free_chars; // chars in the free lists (worth a NU_Compact_Text_Arena once it is a large part of the buffer)
     struct Vector text_refs;
     struct Vector char_buffer;
+    struct Vector rows;  // struct Text_Row, one block per broken text ref
+    uint32_t free_rows;  // rows in blocks no text ref uses any more (compacted once they are half of the rows)
+    uint32_t generation; // bumped by every change to the refs, free lists or chars (see NU_Touch_Text)
+    struct Vector block_generations; // uint32_t per NU_TEXT_COPY_BLOCK chars, bumped by every write to them
 };
 
 struct Font_Resource
@@ -159,11 +252,50 @@ struct Font_Registry {
 
 struct UI_Tree
 {
-    struct Vector tree_stack[MAX_TREE_DEPTH];
+    struct Vector* tree_stack; // layer_count layers (see NU_Reserve_Layers)
+    struct Vector* cold_stack; // struct Node_Cold, parallel to tree_stack
+    struct Vector* free_slots; // struct Layer_Free_Run
+    uint32_t layer_count;      // > deepest_layer + 1 -> the layer below the deepest one always exists (empty)
+    uint32_t layer_capacity;
+    uint32_t* layer_generations; // per layer, bumped by every change to its nodes (see NU_Touch_Layer)
+    uint32_t id_generation;      // bumped by every change to the handles or ids
+    struct Vector handles; // struct Node_Handle_Slot
+    uint32_t free_handle;  // first free handle slot, UINT32_MAX if none
+    struct Vector id_chars; // null terminated id strings
+    struct Vector id_table; // struct Id_Slot, power of two size
+    uint32_t id_count;
     struct Text_Arena text_arena;
+    struct File_Map src_file; // kept alive for the tree's lifetime (text refs point into it)
+    struct File_Map bin_file; // precompiled file the layers and text are used from in place (see precompiled.h)
     uint16_t deepest_layer;
     struct Vector font_resources;
     struct Vector font_registries;
+    struct NU_Layout_Pool* layout_pool; // NULL == full layouts run on the calling thread (see NU_Layout_Pool_Init)
+    struct Region region; // owns the layer, text, handle and id vectors (a tree must not be moved once initialised)
+};
+
+struct NU_Parser
+{
+    // Tree builder state
+    struct UI_Tree* ui_tree;
+    int current_layer;
+    enum NU_Grammar grammar;
+    enum NU_Token pending_property;
+
+    // Tokeniser context (kept between NU_Parse_Feed calls)
+    uint8_t ctx; // 0 == globalspace, 1 == commentspace, 2 == tagspace, 3 == propertyspace
+    uint8_t src_persistent; // 1 == the src buffer outlives the tree so text can be referenced in place
+    uint32_t src_offset;    // position of the tokenised buffer within the persistent src (parallel parse groups)
+    uint8_t text_in_source; // text stays in the src buffer until a tab or newline splits it
+    uint32_t text_arena_buffer_index;
+    uint32_t text_src_index;
+    uint32_t text_char_count;
+    struct Vector carry; // unconsumed tail of the previous chunk (a partial word, property value or tag opener)
+    uint32_t carry_tried; // carry size when it was last tokenised (it is tokenised again once it has doubled)
+
+    // Benchmarking (tokens are counted, tokenise_only skips the tree builder to time the tokeniser on its own)
+    uint8_t tokenise_only;
+    uint32_t token_count;
 };
 
 // Structs ---------------------- //
@@ -172,14 +304,37 @@ struct UI_Tree
 
 // Internal Functions ----------- //
 
-static enum NU_Token NU_Word_To_NU_Token(char word[], uint8_t word_char_count)
+// The length and one or two chars pick the only keyword a word can be, one memcmp confirms it (no tables,
+// nothing to build, safe from any thread)
+static enum NU_Token NU_Word_To_NU_Token(char word[], uint32_t word_char_count)
 {
-    for (uint8_t i=0; i<KEYWORD_COUNT; i++) {
-        size_t len = keyword_lengths[i];
-        if (len == word_char_count && memcmp(word, keywords[i], len) == 0) {
-            return i;
-        }
+    enum NU_Token candidate = UNDEFINED;
+    switch (word_char_count)
+    {
+        case 2: candidate = ID_PROPERTY; break;
+        case 3: candidate = LAYOUT_DIRECTION_PROPERTY; break;
+        case 4:
+            if (word[0] == 'g') candidate = (word[2] == 'o') ? GROW_PROPERTY : GRID_TAG;
+            else if (word[0] == 'r') candidate = RECT_TAG;
+            else if (word[0] == 't') candidate = TEXT_TAG;
+            break;
+        case 5:
+            if (word[0] == 'w') candidate = WIDTH_PROPERTY;
+            else if (word[0] == 'i') candidate = IMAGE_TAG;
+            break;
+        case 6:
+            if (word[0] == 'h') candidate = HEIGHT_PROPERTY;
+            else if (word[0] == 'a') candidate = (word[5] == 'H') ? ALIGN_H_PROPERTY : ALIGN_V_PROPERTY;
+            else if (word[0] == 'w') candidate = WINDOW_TAG;
+            else if (word[0] == 'b') candidate = BUTTON_TAG;
+            break;
+        case 8: candidate = (word[1] == 'i') ? MIN_WIDTH_PROPERTY : MAX_WIDTH_PROPERTY; break;
+        case 9:
+            if (word[0] == 'o') candidate = (word[8] == 'V') ? OVERFLOW_V_PROPERTY : OVERFLOW_H_PROPERTY;
+            else candidate = (word[1] == 'i') ? MIN_HEIGHT_PROPERTY : MAX_HEIGHT_PROPERTY;
+            break;
     }
+    if (candidate != UNDEFINED && memcmp(word, keywords[candidate], word_char_count) == 0) return candidate;
     return UNDEFINED;
 }
 
@@ -190,620 +345,1136 @@ static enum Tag NU_Token_To_Tag(enum NU_Token NU_Token)
     return NU_Token - PROPERTY_COUNT;
 }
 
-static void NU_Tokenise(char* src_buffer, uint32_t src_length, struct Vector* NU_Token_vector, struct Vector* ptext_ref_vector, struct Text_Arena* text_arena) 
+static int NU_Is_Token_Property(enum NU_Token NU_Token)
 {
-    // Store current NU_Token word
-    uint8_t word_char_index = 0;
-    char word[24];
-
-    // Store global text char indexes
-    uint32_t text_arena_buffer_index = 0;
-    uint32_t text_char_count = 0;
+    return NU_Token < PROPERTY_COUNT;
+}
 
-    // Context
-    uint8_t ctx = 0; // 0 == globalspace, 1 == commentspace, 2 == tagspace, 3 == propertyspace
+static int Property_Text_To_Float(float* result, char* text, uint32_t char_count)
+{
+    *result = 0.0f;
+    float fraction_divider = 1.0f;
+    int decimal_found = 0;
 
-    // Iterate over src file 
-    uint32_t i = 0;
-    while (i < src_length)
+    for (uint32_t i = 0; i < char_count; i++)
     {
-        char c = src_buffer[i];
+        char c = text[i];
 
-        // Comment begins
-        if (i < src_length - 3 && c == '<' && src_buffer[i+1] == '!' && src_buffer[i+2] == '-' && src_buffer[i+3] == '-' && ctx == 0)
+        if (c == '.')
         {
-            ctx = 1;
-            i+=4;
+            if (decimal_found) 
+            {
+                *result = 0.0f;
+                return -1;
+            }
+            decimal_found = 1;
             continue;
         }
 
-        // Comment ends
-        if (ctx == 1 && i < src_length - 2 && c == '-' && src_buffer[i+1] == '-' && src_buffer[i+2] == '>')
+        if (c < '0' || c > '9')
         {
-            ctx = 0;
-            i+=3;
-            continue;
+            *result = 0.0f;
+            return -1;
         }
 
-        // In comment
-        if (ctx == 1)
+        int digit = c - '0';
+
+        if (!decimal_found)
         {
-            i+=1;
-            continue;
+            *result = (*result * 10.0f) + digit;
         }
-
-        // Open end tag
-        if (ctx == 0 && i < src_length - 1 && c == '<' && src_buffer[i+1] == '/')
+        else
         {
-            // Reset global text character count
-            if (text_char_count > 0)
-            {
-                char null_terminator = '\0';
-                Vector_Push(&text_arena->char_buffer, &null_terminator); // add null terminator
-                struct Text_Ref new_ref;
-                new_ref.char_count = text_char_count;
-                new_ref.char_capacity = text_char_count;
-                new_ref.buffer_index = text_arena_buffer_index;
-                Vector_Push(&text_arena->text_refs, &new_ref);
-
-                // Add text content token
-                enum NU_Token t = TEXT_CONTENT;
-                Vector_Push(NU_Token_vector, &t);
-            }
-            text_char_count = 0;
-
-            enum NU_Token t = OPEN_END_TAG;
-            Vector_Push(NU_Token_vector, &t);
-            word_char_index = 0;
-            ctx = 2;
-            i+=2;
-            continue;
+            fraction_divider *= 10.0f;
+            *result += digit / fraction_divider;
         }
+    }
 
-        // Tag begins
-        if (ctx == 0 && c == '<')
-        {
-            // Reset global text character count
-            if (text_char_count > 0)
-            {
-                char null_terminator = '\0';
-                Vector_Push(&text_arena->char_buffer, &null_terminator); // add null terminator
-                struct Text_Ref new_ref;
-                new_ref.char_count = text_char_count;
-                new_ref.char_capacity = text_char_count;
-                new_ref.buffer_index = text_arena_buffer_index;
-                Vector_Push(&text_arena->text_refs, &new_ref);
-
-                // Add text content token
-                enum NU_Token t = TEXT_CONTENT;
-                Vector_Push(NU_Token_vector, &t);
-            }
-            text_char_count = 0;
+    return 0;   
+}
 
-            enum NU_Token t = OPEN_TAG;
-            Vector_Push(NU_Token_vector, &t);
-            word_char_index = 0;
-            ctx = 2;
-            i+=1;
-            continue;
-        }
+static const double NU_Pow10[17] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16 };
 
-        // Self closing end tag
-        if (ctx == 2 && i < src_length - 1 && c == '/' && src_buffer[i+1] == '>')
-        {
-            if (word_char_index > 0) {
-                enum NU_Token t = NU_Word_To_NU_Token(word, word_char_index);
-                Vector_Push(NU_Token_vector, &t);
-            }
-            enum NU_Token t = CLOSE_END_TAG;
-            Vector_Push(NU_Token_vector, &t);
-            word_char_index = 0;
-            ctx = 0;
-            i+=2;
-            continue;
-        }
+// Parses 8 decimal digits at once (SWAR). Returns -1 if any of them is not a digit.
+static int Property_Eight_Digits_To_Int(const char* text, uint64_t* result)
+{
+    uint64_t word;
+    memcpy(&word, text, 8);
+    if ((word & 0xF0F0F0F0F0F0F0F0ull) != 0x3030303030303030ull ||
+        ((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) != 0x3030303030303030ull) {
+        return -1;
+    }
 
-        // Tag ends
-        if (ctx == 2 && c == '>')
-        {
-            if (word_char_index > 0) {
-                enum NU_Token t = NU_Word_To_NU_Token(word, word_char_index);
-                Vector_Push(NU_Token_vector, &t);
-            }
-            enum NU_Token t = CLOSE_TAG;
-            Vector_Push(NU_Token_vector, &t);
-            word_char_index = 0;
-            ctx = 0;
-            i+=1;
-            continue;
-        }
+    // Combine digit pairs, then pairs of pairs, then the two halves (first digit is in the low byte)
+    word -= 0x3030303030303030ull;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+            (((word >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    *result = word;
+    return 0;
+}
 
-        // Property assignment
-        if (ctx == 2 && c == '=')
+// Parses "<number>[px|em|%|fr]" into a value and unit. Returns -1 (value untouched) if the text is not a size.
+static int Property_Text_To_Size(float* result, uint8_t* unit, char* text, uint32_t char_count)
+{
+    // Unit suffix
+    double scale = 1.0;
+    *unit = UNIT_PX;
+    if (char_count > 1 && text[char_count-1] == '%') {
+        *unit = UNIT_PERCENT;
+        char_count -= 1;
+    }
+    else if (char_count > 2 && text[char_count-1] > '9')
+    {
+        uint16_t suffix = (uint8_t) text[char_count-2] | ((uint16_t) (uint8_t) text[char_count-1] << 8);
+        switch (suffix)
         {
-            if (word_char_index > 0) {
-                enum NU_Token t = NU_Word_To_NU_Token(word, word_char_index);
-                Vector_Push(NU_Token_vector, &t);
-            }
-            word_char_index = 0;
-            enum NU_Token t = PROPERTY_ASSIGNMENT;
-            Vector_Push(NU_Token_vector, &t);
-            i+=1;
-            continue;
+            case 'p' | ('x' << 8): break;
+            case 'e' | ('m' << 8): scale = NU_EM_PX; break;
+            case 'f' | ('r' << 8): *unit = UNIT_FR; break;
+            default: return -1;
         }
+        char_count -= 2;
+    }
+    if (char_count == 0 || (char_count == 1 && text[0] == '.')) return -1;
+
+    // Very long numbers take the float path
+    if (char_count > 17) {
+        float value;
+        if (Property_Text_To_Float(&value, text, char_count) != 0) return -1;
+        *result = value * (float) scale;
+        return 0;
+    }
 
-        // Property value begins
-        if (ctx == 2 && c == '"')
-        {
-            ctx = 3;
-            i+=1;
+    // Every digit goes into one integer, the dot only decides the power of ten it is divided by
+    uint64_t mantissa = 0;
+    uint32_t i = 0;
+    uint32_t frac_count = 0;
+    uint32_t dot_found = 0;
+    if (char_count >= 8 && Property_Eight_Digits_To_Int(text, &mantissa) == 0) i = 8;
+    for (; i < char_count; i++)
+    {
+        uint32_t digit = (uint8_t) text[i] - '0';
+        if (digit < 10) {
+            mantissa = mantissa * 10 + digit;
+            frac_count += dot_found;
             continue;
         }
+        if (text[i] != '.' || dot_found) return -1;
+        dot_found = 1;
+    }
+    *result = (float) ((double) mantissa * scale / NU_Pow10[frac_count]);
+    return 0;
+}
 
-        // Property value ends
-        if (ctx == 3 && c == '"')
-        {
-            enum NU_Token t = PROPERTY_VALUE;
-            Vector_Push(NU_Token_vector, &t);
-            if (word_char_index > 0)
-            {
-                struct Property_Text_Ref ref;
-                ref.NU_Token_index = NU_Token_vector->size - 1;
-                ref.src_index = i - word_char_index;
-                ref.char_count = word_char_index;
-                Vector_Push(ptext_ref_vector, &ref);
-            }
-            word_char_index = 0;
-            ctx = 2;
-            i+=1;
-            continue;
-        }
+static char Property_Text_To_Alignment(char* text, uint32_t char_count, char current_alignment)
+{
+    // The length alone tells the keywords apart
+    switch (char_count)
+    {
+        case 4: return memcmp(text, "left", 4) == 0 ? 0 : current_alignment;
+        case 6: return memcmp(text, "center", 6) == 0 ? 1 : current_alignment;
+        case 5: return memcmp(text, "right", 5) == 0 ? 2 : current_alignment;
+        default: return current_alignment;
+    }
+}
 
-        // If global space and split character
-        if (ctx == 0 && c != '\t' && c != '\n')
-        {
-            // text continues
-            if (text_char_count > 0)
-            {
-                Vector_Push(&text_arena->char_buffer, &c);
-                text_char_count += 1;
-            }
+static void NU_Apply_Property(struct Node* node, enum NU_Token property, char* ptext, uint32_t char_count)
+{
+    char c = ptext[0];
+
+    // Size properties share one decode (min and max sizes only take absolute units)
+    float value;
+    uint8_t unit = UNIT_PX;
+    int size_valid = 0;
+    if (property >= WIDTH_PROPERTY && property <= MAX_HEIGHT_PROPERTY) {
+        size_valid = Property_Text_To_Size(&value, &unit, ptext, char_count) == 0;
+    }
+    int absolute_size_valid = size_valid && unit == UNIT_PX;
 
-            // text starts
-            if (text_char_count == 0 && c != ' ')
+    switch (property)
+    {
+        // Set layout direction
+        case LAYOUT_DIRECTION_PROPERTY:
+            if (c == 'h') 
+                node->layout_flags |= LAYOUT_HORIZONTAL;
+            else 
+                node->layout_flags |= LAYOUT_VERTICAL;
+            break;
+
+        // Set growth
+        case GROW_PROPERTY:
+            switch(c)
             {
-                text_arena_buffer_index = text_arena->char_buffer.size;
-                Vector_Push(&text_arena->char_buffer, &c);
-                text_char_count = 1;
+                case 'v':
+                    node->layout_flags |= GROW_VERTICAL;
+                    break;
+                case 'h':
+                    node->layout_flags |= GROW_HORIZONTAL;
+                    break;
+                case 'b':
+                    node->layout_flags |= (GROW_HORIZONTAL | GROW_VERTICAL);
+                    break;
+            }
+            break;
+        
+        // Set overflow behaviour
+        case OVERFLOW_V_PROPERTY:
+            if (c == 's') 
+                node->layout_flags |= OVERFLOW_VERTICAL_SCROLL;
+            break;
+        
+        case OVERFLOW_H_PROPERTY:
+            if (c == 's') 
+                node->layout_flags |= OVERFLOW_HORIZONTAL_SCROLL;
+            break;
+        
+        // Set preferred width
+        case WIDTH_PROPERTY:
+            if (size_valid) {
+                node->preferred_width = value;
+                node->width_unit = unit;
             }
+            break;
+
+        // Set min width
+        case MIN_WIDTH_PROPERTY:
+            if (absolute_size_valid) 
+                node->min_width = value;
+            break;
+
+        // Set max width
+        case MAX_WIDTH_PROPERTY:
+            if (absolute_size_valid) 
+                node->max_width = value;
+            break;
+
+        // Set preferred height
+        case HEIGHT_PROPERTY:
+            if (size_valid) {
+                node->preferred_height = value;
+                node->height_unit = unit;
+            }
+            break;
+
+        // Set min height
+        case MIN_HEIGHT_PROPERTY:
+            if (absolute_size_valid) 
+                node->min_height = value;
+            break;
+
+        // Set max height
+        case MAX_HEIGHT_PROPERTY:
+            if (absolute_size_valid) 
+                node->max_height = value;
+            break;
+
+        // Set horizontal alignment
+        case ALIGN_H_PROPERTY:
+            node->horizontal_alignment = Property_Text_To_Alignment(ptext, char_count, node->horizontal_alignment);
+            break;
+
+        // Set vertical alignment
+        case ALIGN_V_PROPERTY:
+            node->vertical_alignment = Property_Text_To_Alignment(ptext, char_count, node->vertical_alignment);
+            break;
+            
+        default:
+            break;
+    }
+}
 
-            i+=1;
-            continue;
-        }
+static struct Node* NU_Parser_Current_Node(struct NU_Parser* parser)
+{
+    struct Vector* layer = &parser->ui_tree->tree_stack[parser->current_layer];
+    return Vector_Last_Node(layer);
+}
 
-        // If split character
-        if (c == ' ' || c == '\t' || c == '\n')
-        {
-            if (word_char_index > 0) {
-                enum NU_Token t = NU_Word_To_NU_Token(word, word_char_index);
-                Vector_Push(NU_Token_vector, &t);
-            }
-            word_char_index = 0;
-            i+=1;
-            continue;
-        }
+// Default properties of a new node (parent_index and ID are set by the caller)
+static void NU_Init_Node(struct Node* new_node, struct Node_Cold* new_cold, enum Tag tag)
+{
+    new_node->tag = tag;
+    new_node->preferred_width = 0.0f;
+    new_node->preferred_height = 0.0f;
+    new_node->gap = 1.0f;
+    new_node->max_width = 10e20f;
+    new_node->min_width = 0.0f;
+    new_node->max_height = 10e20f;
+    new_node->min_height = 0.0f;
+    new_node->pad_top = 8;
+    new_node->pad_bottom = 8;
+    new_node->pad_left = 8;
+    new_node->pad_right = 8;
+    new_node->border_top = 1;
+    new_node->border_bottom = 2;
+    new_node->border_left = 1;
+    new_node->border_right = 10;
+    new_node->child_count = 0;
+    new_node->first_child_index = -1;
+    new_node->layout_flags = 0;
+    new_node->width_unit = UNIT_PX;
+    new_node->height_unit = UNIT_PX;
+    new_node->horizontal_alignment = 0;
+    new_node->vertical_alignment = 0;
+    new_node->dirty = NU_DIRTY_ALL;
+
+    memset(new_cold, 0, sizeof(*new_cold));
+    new_cold->window = NULL; 
+    new_cold->vg = NULL;
+    new_cold->border_radius_tl = 0;
+    new_cold->border_radius_tr = 12;
+    new_cold->border_radius_bl = 12;
+    new_cold->border_radius_br = 0;
+    new_cold->child_capacity = 0;
+    new_cold->text_ref_index = -1;
+    new_cold->handle_index = -1;
+    new_cold->id_index = -1;
+}
+
+// Text arena blocks: a text that outgrows its block moves to a best fit free block (or the end of the char buffer)
+// and its old block is freed. Free blocks are kept in size classes, class c holds blocks of 2^c to 2^(c+1)-1 chars.
+// A block at the end of the char buffer is given back to the buffer instead.
+#define NU_TEXT_BLOCK_ALIGN 8      // new blocks are rounded up so small changes in length stay in place
+#define NU_MIN_TEXT_BLOCK 16       // smaller leftovers of a split block stay with the block
+#define NU_TEXT_COPY_BLOCK 4096    // chars per entry of the arena's block generations
+
+static uint32_t NU_Text_Size_Class(uint32_t length)
+{
+    uint32_t size_class = 0;
+    while (length >>= 1) size_class++;
+    return size_class;
+}
 
-        // If tag space or property space
-        if (ctx == 2 || ctx == 3)
+// Bumps the arena's generation and the generations of the char blocks [start, end) lies in (start == end -> only
+// the refs or free lists changed). Tree snapshots copy only the blocks whose generation moved (see tree_snapshot.h).
+static void NU_Touch_Text(struct Text_Arena* text_arena, uint32_t start, uint32_t end)
+{
+    text_arena->generation += 1;
+    if (start == end) return;
+    struct Vector* block_generations = &text_arena->block_generations;
+    uint32_t block_count = (end + NU_TEXT_COPY_BLOCK - 1) / NU_TEXT_COPY_BLOCK;
+    if (block_generations->size < block_count)
+    {
+        uint32_t old_count = block_generations->size;
+        Vector_Resize(block_generations, block_count);
+        memset((uint32_t*) block_generations->data + old_count, 0, (block_count - old_count) * sizeof(uint32_t));
+    }
+    for (uint32_t b=start / NU_TEXT_COPY_BLOCK; b<block_count; b++) {
+        ((uint32_t*) block_generations->data)[b] += 1;
+    }
+}
+
+static void NU_Text_Arena_Free(struct Text_Arena* text_arena, uint32_t index, uint32_t length)
+{
+    NU_Touch_Text(text_arena, 0, 0);
+    if (index + length == text_arena->char_buffer.size)
+    {
+        text_arena->char_buffer.size = index;
+        return;
+    }
+    struct Arena_Free_Element free_element;
+    free_element.index = index;
+    free_element.length = length;
+    Vector_Push(&text_arena->free_lists[NU_Text_Size_Class(length)], &free_element);
+    text_arena->free_chars += length;
+}
+
+// Returns the index of a block of at least *length chars and writes the block's real length
+static uint32_t NU_Text_Arena_Alloc(struct Text_Arena* text_arena, uint32_t* length)
+{
+    // Best fit within the length's own class, otherwise any block of a larger class
+    uint32_t needed = *length;
+    struct Vector* free_list = NULL;
+    int best = -1;
+    for (uint32_t c=NU_Text_Size_Class(needed); c<NU_TEXT_SIZE_CLASSES && best == -1; c++)
+    {
+        free_list = &text_arena->free_lists[c];
+        struct Arena_Free_Element* blocks = free_list->data;
+        for (uint32_t i=0; i<free_list->size; i++)
         {
-            word[word_char_index] = c;
-            word_char_index+=1;
+            if (blocks[i].length < needed || (best != -1 && blocks[i].length >= blocks[best].length)) continue;
+            best = i;
+            if (blocks[i].length == needed) break;
         }
-
-        i+=1;
+    }
+    if (best == -1)
+    {
+        uint32_t index = text_arena->char_buffer.size;
+        Vector_Resize(&text_arena->char_buffer, index + needed);
+        return index;
     }
 
-    if (word_char_index > 0) {
-        enum NU_Token t = NU_Word_To_NU_Token(word, word_char_index);
-        Vector_Push(NU_Token_vector, &t);
+    struct Arena_Free_Element block = *(struct Arena_Free_Element*) Vector_Get(free_list, best);
+    *(struct Arena_Free_Element*) Vector_Get(free_list, best) = *(struct Arena_Free_Element*) Vector_Get(free_list, free_list->size - 1);
+    free_list->size -= 1;
+    text_arena->free_chars -= block.length;
+    if (block.length - needed >= NU_MIN_TEXT_BLOCK)
+    {
+        NU_Text_Arena_Free(text_arena, block.index + needed, block.length - needed);
+        block.length = needed;
     }
+    *length = block.length;
+    return block.index;
 }
 
-static int NU_Is_Token_Property(enum NU_Token NU_Token)
+// Writes the text into the ref's block when it fits, otherwise moves the ref to a new block
+static void NU_Write_Text(struct Text_Arena* text_arena, struct Text_Ref* text_ref, const char* text, uint32_t char_count)
 {
-    return NU_Token < PROPERTY_COUNT;
+    text_ref->measured_font = -1;
+    if (!text_ref->in_source && char_count <= text_ref->char_capacity)
+    {
+        char* chars = (char*) text_arena->char_buffer.data + text_ref->buffer_index;
+        memcpy(chars, text, char_count);
+        chars[char_count] = '\0';
+        text_ref->char_count = char_count;
+        NU_Touch_Text(text_arena, text_ref->buffer_index, text_ref->buffer_index + char_count + 1);
+        return;
+    }
+    if (!text_ref->in_source) NU_Text_Arena_Free(text_arena, text_ref->buffer_index, text_ref->char_capacity + 1);
+
+    uint32_t length = (char_count + NU_TEXT_BLOCK_ALIGN) & ~(NU_TEXT_BLOCK_ALIGN - 1); // + null terminator, rounded up
+    text_ref->buffer_index = NU_Text_Arena_Alloc(text_arena, &length);
+    text_ref->char_count = char_count;
+    text_ref->char_capacity = length - 1;
+    text_ref->in_source = 0;
+    char* chars = (char*) text_arena->char_buffer.data + text_ref->buffer_index;
+    memcpy(chars, text, char_count);
+    chars[char_count] = '\0';
+    NU_Touch_Text(text_arena, text_ref->buffer_index, text_ref->buffer_index + char_count + 1);
 }
 
-static int Property_Text_To_Float(float* result, char* src_buffer, struct Property_Text_Ref* ptext_ref)
+static void NU_Clear_Text_Free_Lists(struct Text_Arena* text_arena)
 {
-    *result = 0.0f;
-    float fraction_divider = 1.0f;
-    int decimal_found = 0;
+    NU_Touch_Text(text_arena, 0, 0);
+    for (int c=0; c<NU_TEXT_SIZE_CLASSES; c++) {
+        text_arena->free_lists[c].size = 0;
+    }
+    text_arena->free_chars = 0;
+}
+
+#define NU_MIN_LAYER_RESERVE 8
 
-    for (uint8_t i = 0; i < ptext_ref->char_count; i++)
+// Adds layers until there are layer_count. Each new layer reserves room for as many nodes as its parent
+// layer holds so far (1 for the root layer). Pointers to the layer vectors are invalid afterwards.
+static void NU_Reserve_Layers(struct UI_Tree* ui_tree, uint32_t layer_count)
+{
+    if (layer_count <= ui_tree->layer_count) return;
+    struct Region* region = &ui_tree->region;
+    if (layer_count > ui_tree->layer_capacity)
+    {
+        uint32_t capacity = MAX(ui_tree->layer_capacity * 2, 8);
+        while (capacity < layer_count) capacity *= 2;
+        size_t old_size = ui_tree->layer_capacity * sizeof(struct Vector);
+        size_t new_size = capacity * sizeof(struct Vector);
+        ui_tree->tree_stack = Region_Realloc(region, ui_tree->tree_stack, old_size, new_size);
+        ui_tree->cold_stack = Region_Realloc(region, ui_tree->cold_stack, old_size, new_size);
+        ui_tree->free_slots = Region_Realloc(region, ui_tree->free_slots, old_size, new_size);
+        ui_tree->layer_generations = Region_Realloc(region, ui_tree->layer_generations, ui_tree->layer_capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+        ui_tree->layer_capacity = capacity;
+    }
+    for (uint32_t l=ui_tree->layer_count; l<layer_count; l++)
     {
-        char c = src_buffer[ptext_ref->src_index + i];
+        ui_tree->layer_generations[l] = 0;
+        uint32_t reserve = (l == 0) ? 1 : MAX(ui_tree->tree_stack[l-1].size, NU_MIN_LAYER_RESERVE);
+        Vector_Reserve_Region(&ui_tree->tree_stack[l], region, sizeof(struct Node), reserve);
+        Vector_Reserve_Region(&ui_tree->cold_stack[l], region, sizeof(struct Node_Cold), reserve);
+        Vector_Reserve_Region(&ui_tree->free_slots[l], region, sizeof(struct Layer_Free_Run), 4);
+    }
+    ui_tree->layer_count = layer_count;
+}
 
-        if (c == '.')
-        {
-            if (decimal_found) 
-            {
-                *result = 0.0f;
-                return -1;
-            }
-            decimal_found = 1;
-            continue;
-        }
+// Records a change to a layer's nodes, cold nodes or free runs (tree snapshots copy only the layers whose
+// generation moved, see tree_snapshot.h)
+static void NU_Touch_Layer(struct UI_Tree* ui_tree, uint32_t layer)
+{
+    ui_tree->layer_generations[layer] += 1;
+}
 
-        if (c < '0' || c > '9')
-        {
-            *result = 0.0f;
-            return -1;
-        }
+// Gives the node a slot in the handle table if it has none yet (a free slot keeps its bumped generation)
+static uint32_t NU_Acquire_Handle_Slot(struct UI_Tree* ui_tree, struct Node_Cold* cold)
+{
+    if (cold->handle_index != -1) return cold->handle_index;
+    ui_tree->id_generation += 1;
+    if (ui_tree->free_handle != UINT32_MAX)
+    {
+        cold->handle_index = ui_tree->free_handle;
+        struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, cold->handle_index);
+        ui_tree->free_handle = slot->node_ID;
+    }
+    else
+    {
+        struct Node_Handle_Slot new_slot;
+        new_slot.generation = 0;
+        cold->handle_index = ui_tree->handles.size;
+        Vector_Push(&ui_tree->handles, &new_slot);
+    }
+    struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, cold->handle_index);
+    slot->node_ID = cold->ID;
+    return cold->handle_index;
+}
 
-        int digit = c - '0';
+// Id table: ids are copied into id_chars and the table maps them to node handles, so a lookup still finds
+// the node after edits move it. The table is kept at most half full. When two nodes share an id the first
+// one keeps it. The chars of a removed id stay in id_chars until the table is rebuilt from a new tree.
+#define NU_ID_TABLE_MIN_SIZE 64 // power of two
 
-        if (!decimal_found)
-        {
-            *result = (*result * 10.0f) + digit;
-        }
-        else
-        {
-            fraction_divider *= 10.0f;
-            *result += digit / fraction_divider;
-        }
+static uint32_t NU_Id_Hash(const char* id, uint32_t length)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (uint32_t i=0; i<length; i++) {
+        h = (h ^ (uint8_t) id[i]) * 16777619u;
     }
+    return h;
+}
 
-    return 0;   
+static void NU_Clear_Id_Table(struct UI_Tree* ui_tree, uint32_t size)
+{
+    ui_tree->id_generation += 1;
+    Vector_Resize(&ui_tree->id_table, size);
+    struct Id_Slot* slots = ui_tree->id_table.data;
+    for (uint32_t i=0; i<size; i++) {
+        slots[i].char_index = UINT32_MAX;
+    }
+    ui_tree->id_count = 0;
 }
 
-static int AssertRootGrammar(struct Vector* token_vector)
+// Returns the slot holding the id or -1
+static int NU_Id_Table_Find(struct UI_Tree* ui_tree, const char* id, uint32_t hash)
 {
-    // ENFORCE RULE: FIRST TOKEN MUST BE OPEN TAG
-    // ENFORCE RULE: SECOND TOKEN MUST BE TAG NAME
-    // ENFORCE RULE: THIRD TOKEN MUST BE CLOSE_TAG | PROPERTY
-    int root_open = token_vector->size > 2 && 
-        *((enum NU_Token*) Vector_Get(token_vector, 0)) == OPEN_TAG &&
-        *((enum NU_Token*) Vector_Get(token_vector, 1)) == WINDOW_TAG;
+    struct Id_Slot* slots = ui_tree->id_table.data;
+    uint32_t mask = ui_tree->id_table.size - 1;
+    const char* id_chars = ui_tree->id_chars.data;
+    for (uint32_t i = hash & mask; slots[i].char_index != UINT32_MAX; i = (i + 1) & mask) {
+        if (slots[i].hash == hash && strcmp(id_chars + slots[i].char_index, id) == 0) return i;
+    }
+    return -1;
+}
+
+static void NU_Id_Table_Place(struct UI_Tree* ui_tree, struct Id_Slot* new_slot)
+{
+    struct Id_Slot* slots = ui_tree->id_table.data;
+    uint32_t mask = ui_tree->id_table.size - 1;
+    uint32_t i = new_slot->hash & mask;
+    while (slots[i].char_index != UINT32_MAX) i = (i + 1) & mask;
+    slots[i] = *new_slot;
+    ui_tree->id_count += 1;
+    ui_tree->id_generation += 1;
+}
 
-    if (token_vector->size > 2 &&
-        *((enum NU_Token*) Vector_Get(token_vector, 0)) == OPEN_TAG &&
-        *((enum NU_Token*) Vector_Get(token_vector, 1)) == WINDOW_TAG) 
+// Adds the node's id (already in id_chars) to the table
+static void NU_Id_Table_Insert(struct UI_Tree* ui_tree, struct Node_Cold* cold)
+{
+    const char* id = (char*) ui_tree->id_chars.data + cold->id_index;
+    struct Id_Slot new_slot;
+    new_slot.hash = NU_Id_Hash(id, strlen(id));
+    if (NU_Id_Table_Find(ui_tree, id, new_slot.hash) != -1) return;
+    new_slot.char_index = cold->id_index;
+    new_slot.handle.index = NU_Acquire_Handle_Slot(ui_tree, cold);
+    new_slot.handle.generation = ((struct Node_Handle_Slot*) Vector_Get(&ui_tree->handles, new_slot.handle.index))->generation;
+
+    // Keep the table at most half full
+    uint32_t size = ui_tree->id_table.size;
+    if ((ui_tree->id_count + 1) * 2 > size)
     {
-        if (token_vector->size > 5 && 
-            *((enum NU_Token*) Vector_Get(token_vector, token_vector->size-3)) == OPEN_END_TAG &&
-            *((enum NU_Token*) Vector_Get(token_vector, token_vector->size-2)) == WINDOW_TAG && 
-            *((enum NU_Token*) Vector_Get(token_vector, token_vector->size-1)) == CLOSE_TAG)
-        {
-            return 0; // Success
-        }
-        else // Closing tag is not window
-        {
-            printf("%s\n", "[Generate_Tree] Error! XML tree root not closed.");
-            return -1;
+        struct Vector old_table = ui_tree->id_table;
+        Vector_Reserve_Region(&ui_tree->id_table, &ui_tree->region, sizeof(struct Id_Slot), size * 2);
+        NU_Clear_Id_Table(ui_tree, size * 2);
+        struct Id_Slot* old_slots = old_table.data;
+        for (uint32_t i=0; i<size; i++) {
+            if (old_slots[i].char_index != UINT32_MAX) NU_Id_Table_Place(ui_tree, &old_slots[i]);
         }
+        Vector_Free(&old_table);
     }
-    else // Root is not a window tag
+    NU_Id_Table_Place(ui_tree, &new_slot);
+}
+
+// Takes the node's id out of the table (if the node is the one that owns it). Later entries of the probe
+// run shift back into the gap so lookups never need tombstones.
+static void NU_Id_Table_Remove(struct UI_Tree* ui_tree, struct Node_Cold* cold)
+{
+    if (cold->id_index == -1) return;
+    const char* id = (char*) ui_tree->id_chars.data + cold->id_index;
+    int found = NU_Id_Table_Find(ui_tree, id, NU_Id_Hash(id, strlen(id)));
+    cold->id_index = -1;
+    struct Id_Slot* slots = ui_tree->id_table.data;
+    if (found == -1 || cold->handle_index == -1 || slots[found].handle.index != (uint32_t) cold->handle_index) return;
+
+    uint32_t mask = ui_tree->id_table.size - 1;
+    uint32_t gap = found;
+    for (uint32_t i = (gap + 1) & mask; slots[i].char_index != UINT32_MAX; i = (i + 1) & mask)
     {
-        printf("%s\n", "[Generate_Tree] Error! XML tree has no root. XML documents must begin with a <window> tag.");
-        return -1;
+        // Entries whose home slot lies cyclically in (gap, i] must stay where they are
+        uint32_t home = slots[i].hash & mask;
+        if (gap <= i ? (gap < home && home <= i) : (gap < home || home <= i)) continue;
+        slots[gap] = slots[i];
+        gap = i;
     }
+    slots[gap].char_index = UINT32_MAX;
+    ui_tree->id_count -= 1;
+    ui_tree->id_generation += 1;
+}
+
+// Gives a node an id (replacing any id it had)
+static void NU_Assign_Node_Id(struct UI_Tree* ui_tree, struct Node_Cold* cold, const char* id, uint32_t length)
+{
+    NU_Id_Table_Remove(ui_tree, cold);
+    ui_tree->id_generation += 1;
+    cold->id_index = ui_tree->id_chars.size;
+    Vector_Push_Range_Char(&ui_tree->id_chars, id, length);
+    Vector_Push_Char(&ui_tree->id_chars, '\0');
+    NU_Id_Table_Insert(ui_tree, cold);
 }
 
-static int AssertNewTagGrammar(struct Vector* token_vector, int i)
+// Rebuilds the table from the nodes' id_index values (for trees whose layers were copied in wholesale). The nodes
+// are visited in document order, so of two nodes sharing an id the first one owns it (as in the parse).
+static void NU_Rebuild_Id_Table(struct UI_Tree* ui_tree)
 {
-    // ENFORCE RULE: NEXT TOKEN SHOULD BE TAG NAME 
-    // ENFORCE RULE: THIRD TOKEN MUST BE CLOSE CLOSE_END OR PROPERTY
-    if (i < token_vector->size - 2 && NU_Token_To_Tag(*((enum NU_Token*) Vector_Get(token_vector, i+1))) != NAT)
+    NU_Clear_Id_Table(ui_tree, MAX(ui_tree->id_table.size, NU_ID_TABLE_MIN_SIZE));
+    if (ui_tree->id_chars.size == 0 || ui_tree->tree_stack[0].size == 0) return;
+    uint32_t path[MAX_TREE_DEPTH];       // the visited node's index on each layer
+    uint32_t next_child[MAX_TREE_DEPTH]; // its next child to visit
+    int layer = 0;
+    path[0] = 0;
+    next_child[0] = 0;
+    struct Node_Cold* cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[0], 0);
+    if (cold->id_index != -1) NU_Id_Table_Insert(ui_tree, cold);
+    while (layer >= 0)
     {
-        enum NU_Token third_token = *((enum NU_Token*) Vector_Get(token_vector, i+2));
-        if (third_token == CLOSE_TAG || third_token == CLOSE_END_TAG || NU_Is_Token_Property(third_token)) return 0; // Success
+        struct Node* node = Vector_Get_Node(&ui_tree->tree_stack[layer], path[layer]);
+        if (next_child[layer] == node->child_count)
+        {
+            layer -= 1;
+            continue;
+        }
+        uint32_t child_index = node->first_child_index + next_child[layer];
+        next_child[layer] += 1;
+        layer += 1;
+        path[layer] = child_index;
+        next_child[layer] = 0;
+        cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[layer], child_index);
+        if (cold->id_index != -1) NU_Id_Table_Insert(ui_tree, cold);
     }
-    return -1; // Failure
 }
 
-static int AssertPropertyGrammar(struct Vector* token_vector, int i)
+static int NU_Parser_Open_Node(struct NU_Parser* parser, enum Tag tag)
 {
-    // ENFORCE RULE: NEXT TOKEN SHOULD BE PROPERTY ASSIGN
-    // ENFORCE RULE: THIRD TOKEN SHOULD BE PROPERTY TEXT
-    if (i < token_vector->size - 2 && *((enum NU_Token*) Vector_Get(token_vector, i+1)) == PROPERTY_ASSIGNMENT)
+    struct UI_Tree* ui_tree = parser->ui_tree;
+    int current_layer = parser->current_layer;
+
+    // Enforce max tree depth
+    if (current_layer+1 == MAX_TREE_DEPTH)
     {
-        if (*((enum NU_Token*) Vector_Get(token_vector, i+2)) == PROPERTY_VALUE) return 0; // Success
-        printf("%s\n", "[Generate_Tree] Error! Expected property value after assignment.");
+        printf("%s %d\n", "[Generate Tree] Error! Exceeded max tree depth of", MAX_TREE_DEPTH);
         return -1; // Failure
     }
-    printf("%s\n", "[Generate_Tree] Error! Expected '=' after property.");
-    return -1; // Failure
+    NU_Reserve_Layers(ui_tree, current_layer + 3); // the new node's layer and the empty one below it
+
+    // Enforce max child count (child_count is 16 bit)
+    if (current_layer != -1 && Vector_Last_Node(&ui_tree->tree_stack[current_layer])->child_count == UINT16_MAX)
+    {
+        printf("%s %d %s\n", "[Generate Tree] Error! A node can't have more than", UINT16_MAX, "children");
+        return -1; // Failure
+    }
+
+    // Create a new node
+    struct Node new_node;
+    struct Node_Cold new_cold;
+    NU_Init_Node(&new_node, &new_cold, tag);
+    new_node.parent_index = (current_layer == -1) ? -1 : (int) ui_tree->tree_stack[current_layer].size - 1; 
+    new_cold.ID = ((uint32_t) (current_layer + 1) << 24) | (ui_tree->tree_stack[current_layer+1].size & 0xFFFFFF); // Max depth = 256, Max node index = 16,777,215
+
+    // Add node to tree
+    struct Vector* node_layer = &ui_tree->tree_stack[current_layer+1];
+    Vector_Push_Node(node_layer, new_node);
+    Vector_Push_Node_Cold(&ui_tree->cold_stack[current_layer+1], new_cold);
+    if (current_layer != -1) // Only equals -1 for the root window node
+    {
+        // Inform parent that parent has new child
+        struct Node* parentNode = Vector_Get_Node(&ui_tree->tree_stack[current_layer], new_node.parent_index);
+        struct Node_Cold* parent_cold = Vector_Get_Node_Cold(&ui_tree->cold_stack[current_layer], new_node.parent_index);
+        if (parentNode->child_count == 0)
+        {
+            parentNode->first_child_index = node_layer->size - 1;
+        }
+        parentNode->child_count += 1;
+        parent_cold->child_capacity += 1;
+    }
+
+    // Move one layer deeper
+    parser->current_layer++;
+    ui_tree->deepest_layer = MAX(ui_tree->deepest_layer, parser->current_layer);
+    return 0; // Success
 }
 
-static int AssertTagCloseStartGrammar(struct Vector* token_vector, int i, enum Tag openTag)
+static void NU_Parser_Close_Node(struct NU_Parser* parser)
 {
-    // ENFORCE RULE: NEXT TOKEN SHOULD BE TAG AND MUST MATCH OPENING TAG
-    // ENDORCE RULE: THIRD TOKEN MUST BE A TAG END
-    if (i < token_vector->size - 2 && 
-        NU_Token_To_Tag(*((enum NU_Token*) Vector_Get(token_vector, i+1))) == openTag && 
-        *((enum NU_Token*) Vector_Get(token_vector, i+2)) == CLOSE_TAG) return 0; // Success
-    else {
-        printf("%s", "[Generate Tree] Error! Closing tag does not match.");
-        printf("%s %d %s %d", "close tag:", NU_Token_To_Tag(*((enum NU_Token*) Vector_Get(token_vector, i+1))), "open tag:", openTag);
-    }
-    return -1; // Failure
+    // Move one layer higher
+    parser->current_layer--;
+    parser->grammar = (parser->current_layer == -1) ? GRAMMAR_DONE : GRAMMAR_CONTENT;
 }
 
-static int NU_Generate_Tree(char* src_buffer, uint32_t src_length, struct UI_Tree* ui_tree, struct Vector* NU_Token_vector, struct Vector* ptext_ref_vector)
+// Consumes one token and builds the tree in place. Grammar is enforced inline (value is only used by PROPERTY_VALUE).
+static int NU_Parser_Apply_Token(struct NU_Parser* parser, enum NU_Token token, char* value, uint32_t value_char_count)
 {
-    // Enforce root grammar
-    if (AssertRootGrammar(NU_Token_vector) != 0) 
+    switch (parser->grammar)
     {
-        return -1; // Failure 
+        case GRAMMAR_ROOT:
+            // ENFORCE RULE: FIRST TOKEN MUST BE OPEN TAG
+            if (token == OPEN_TAG) {
+                parser->grammar = GRAMMAR_TAG_NAME;
+                return 0;
+            }
+            printf("%s\n", "[Generate_Tree] Error! XML tree has no root. XML documents must begin with a <window> tag.");
+            return -1;
+
+        case GRAMMAR_TAG_NAME:
+        {
+            // ENFORCE RULE: NEXT TOKEN SHOULD BE TAG NAME (AND THE ROOT MUST BE A WINDOW)
+            enum Tag tag = NU_Token_To_Tag(token);
+            if (parser->current_layer == -1 && token != WINDOW_TAG) {
+                printf("%s\n", "[Generate_Tree] Error! XML tree has no root. XML documents must begin with a <window> tag.");
+                return -1;
+            }
+            if (token >= OPEN_TAG || tag == NAT) {
+                printf("%s\n", "[Generate_Tree] Error! Expected tag name after '<'.");
+                return -1;
+            }
+            if (NU_Parser_Open_Node(parser, tag) != 0) return -1;
+            parser->grammar = GRAMMAR_TAG;
+            return 0;
+        }
+
+        case GRAMMAR_TAG:
+            // ENFORCE RULE: TAG CONTINUES WITH CLOSE | CLOSE_END | PROPERTY
+            if (token == CLOSE_TAG) {
+                parser->grammar = GRAMMAR_CONTENT;
+                return 0;
+            }
+            if (token == CLOSE_END_TAG) {
+                NU_Parser_Close_Node(parser);
+                return 0;
+            }
+            if (token < OPEN_TAG || token == UNDEFINED) { // unknown property names are skipped
+                parser->pending_property = token;
+                parser->grammar = GRAMMAR_ASSIGNMENT;
+                return 0;
+            }
+            printf("%s\n", "[Generate_Tree] Error! Unexpected token inside tag.");
+            return -1;
+
+        case GRAMMAR_ASSIGNMENT:
+            // ENFORCE RULE: NEXT TOKEN SHOULD BE PROPERTY ASSIGN
+            if (token == PROPERTY_ASSIGNMENT) {
+                parser->grammar = GRAMMAR_VALUE;
+                return 0;
+            }
+            printf("%s\n", "[Generate_Tree] Error! Expected '=' after property.");
+            return -1;
+
+        case GRAMMAR_VALUE:
+            // ENFORCE RULE: THIRD TOKEN SHOULD BE PROPERTY TEXT
+            if (token == PROPERTY_VALUE) {
+                if (value_char_count > 0 && parser->pending_property == ID_PROPERTY) {
+                    struct Vector* cold_layer = &parser->ui_tree->cold_stack[parser->current_layer];
+                    NU_Assign_Node_Id(parser->ui_tree, Vector_Last_Node_Cold(cold_layer), value, value_char_count);
+                }
+                else if (value_char_count > 0 && NU_Is_Token_Property(parser->pending_property)) {
+                    NU_Apply_Property(NU_Parser_Current_Node(parser), parser->pending_property, value, value_char_count);
+                }
+                parser->grammar = GRAMMAR_TAG;
+                return 0;
+            }
+            printf("%s\n", "[Generate_Tree] Error! Expected property value after assignment.");
+            return -1;
+
+        case GRAMMAR_CONTENT:
+            if (token == OPEN_TAG) {
+                parser->grammar = GRAMMAR_TAG_NAME;
+                return 0;
+            }
+            if (token == OPEN_END_TAG) {
+                parser->grammar = GRAMMAR_END_TAG_NAME;
+                return 0;
+            }
+            if (token == TEXT_CONTENT) { // text belongs to the open node
+                struct Vector* text_refs = &parser->ui_tree->text_arena.text_refs;
+                struct Text_Ref* text_ref = Vector_Last_Text_Ref(text_refs);
+                struct Node_Cold* cold = Vector_Last_Node_Cold(&parser->ui_tree->cold_stack[parser->current_layer]);
+                text_ref->node_ID = cold->ID;
+                cold->text_ref_index = text_refs->size - 1;
+                return 0;
+            }
+            printf("%s\n", "[Generate_Tree] Error! Unexpected token between tags.");
+            return -1;
+
+        case GRAMMAR_END_TAG_NAME:
+        {
+            // ENFORCE RULE: NEXT TOKEN SHOULD BE TAG AND MUST MATCH OPENING TAG
+            enum Tag openTag = NU_Parser_Current_Node(parser)->tag;
+            if (token < OPEN_TAG && NU_Token_To_Tag(token) == openTag) {
+                parser->grammar = GRAMMAR_END_TAG_CLOSE;
+                return 0;
+            }
+            printf("%s", "[Generate Tree] Error! Closing tag does not match.");
+            printf("%s %d %s %d\n", "close tag:", NU_Token_To_Tag(token), "open tag:", openTag);
+            return -1;
+        }
+
+        case GRAMMAR_END_TAG_CLOSE:
+            // ENDORCE RULE: THIRD TOKEN MUST BE A TAG END
+            if (token == CLOSE_TAG) {
+                NU_Parser_Close_Node(parser);
+                return 0;
+            }
+            printf("%s\n", "[Generate Tree] Error! Closing tag does not match.");
+            return -1;
+
+        case GRAMMAR_DONE:
+            printf("%s\n", "[Generate_Tree] Error! Content found after the XML tree root.");
+            return -1;
+
+        default:
+            return -1;
+    }
+}
+
+static int NU_Parser_Token(struct NU_Parser* parser, enum NU_Token token, char* value, uint32_t value_char_count)
+{
+    parser->token_count++;
+    if (parser->tokenise_only) return 0;
+    if (NU_Parser_Apply_Token(parser, token, value, value_char_count) == 0) return 0;
+    parser->grammar = GRAMMAR_ERROR;
+    return -1;
+}
+
+static int NU_Push_Text_Content(struct NU_Parser* parser, uint32_t buffer_index, uint32_t text_char_count, uint8_t in_source)
+{
+    // Arena text is null terminated, src file text is referenced in place
+    struct Text_Arena* text_arena = &parser->ui_tree->text_arena;
+    if (parser->tokenise_only) return NU_Parser_Token(parser, TEXT_CONTENT, NULL, 0);
+    if (!in_source) {
+        Vector_Push_Char(&text_arena->char_buffer, '\0'); // add null terminator
     }
+    struct Text_Ref new_ref = {0}; // no rows yet
+    new_ref.char_count = text_char_count;
+    new_ref.char_capacity = text_char_count;
+    new_ref.buffer_index = buffer_index;
+    new_ref.in_source = in_source;
+    new_ref.measured_font = -1;
+    new_ref.break_width = -1.0f;
+    Vector_Push_Text_Ref(&text_arena->text_refs, new_ref);
+
+    // Add text content token
+    return NU_Parser_Token(parser, TEXT_CONTENT, NULL, 0);
+}
 
-    // Get first property text reference
-    uint32_t property_text_index = 0;
-    struct Property_Text_Ref* current_property_text;
-    if (ptext_ref_vector->size > 0) current_property_text = Vector_Get(ptext_ref_vector, property_text_index);
+// Tokenises the src buffer and feeds each token straight into the tree builder (single pass).
+// Unless is_final is set, the tokeniser stops in front of a word, property value or tag opener that may continue 
+// in the next chunk and reports how many bytes it consumed. Text content is copied as it goes so it never needs carrying.
+static int NU_Tokenise(char* src_buffer, uint32_t src_length, struct NU_Parser* parser, uint8_t is_final, uint32_t* consumed_out) 
+{
+    struct Text_Arena* text_arena = &parser->ui_tree->text_arena;
+    uint8_t ctx = parser->ctx;
 
-    // Get first text content reference
-    uint32_t text_content_ref_index = 0;
+    // Store current NU_Token word (a slice of the src buffer)
+    uint32_t word_start = 0;
+    uint32_t word_char_count = 0;
 
-    // Iterate over all NU_Tokens
-    int i = 0;
-    int current_layer = -1;
-    ui_tree->deepest_layer = 0;
-    struct Node* current_node = NULL;
-    uint32_t current_node_ID = 0;
-    while (i < NU_Token_vector->size - 3)
+    // Iterate over src file, jumping straight between structural characters
+    uint32_t i = 0;
+    while (i < src_length)
     {
-        const enum NU_Token NU_Token = *((enum NU_Token*) Vector_Get(NU_Token_vector, i));
-
-        // New tag -> Add a new node
-        if (NU_Token == OPEN_TAG)
+        // Global space -> copy the run of text up to the next '<', tab or newline
+        if (ctx == 0)
         {
-            if (AssertNewTagGrammar(NU_Token_vector, i) == 0)
+            uint32_t run_end = Scan_Until(src_buffer, i, src_length, SCAN_TEXT);
+
+            // text starts at the first non space character
+            if (parser->text_char_count == 0)
             {
-                // Enforce max tree depth
-                if (current_layer+1 == MAX_TREE_DEPTH)
-                {
-                    printf("%s", "[Generate Tree] Error! Exceeded max tree depth of 64");
-                    return -1; // Failure
-                }
+                while (i < run_end && src_buffer[i] == ' ') i++;
+                parser->text_src_index = i;
+                parser->text_in_source = parser->src_persistent;
+                parser->text_arena_buffer_index = text_arena->char_buffer.size;
+            }
 
-                // Create a new node
-                struct Node new_node;
-                current_node_ID = ((uint32_t) (current_layer + 1) << 24) | (ui_tree->tree_stack[current_layer+1].size & 0xFFFFFF); // Max depth = 256, Max node index = 16,777,215
-                new_node.ID = current_node_ID;
-                new_node.tag = NU_Token_To_Tag(*((enum NU_Token*) Vector_Get(NU_Token_vector, i+1)));
-                new_node.window = NULL; 
-                new_node.vg = NULL;
-                new_node.preferred_width = 0.0f;
-                new_node.preferred_height = 0.0f;
-                new_node.gap = 1.0f;
-                new_node.max_width = 10e20f;
-                new_node.min_width = 0.0f;
-                new_node.pad_top = 8;
-                new_node.pad_bottom = 8;
-                new_node.pad_left = 8;
-                new_node.pad_right = 8;
-                new_node.border_top = 1;
-                new_node.border_bottom = 2;
-                new_node.border_left = 1;
-                new_node.border_right = 10;
-                new_node.border_radius_tl = 0;
-                new_node.border_radius_tr = 12;
-                new_node.border_radius_bl = 12;
-                new_node.border_radius_br = 0;
-                new_node.child_count = 0;
-                new_node.first_child_index = -1;
-                new_node.text_ref_index = -1;
-                new_node.layout_flags = 0;
-                new_node.parent_index = ui_tree->tree_stack[current_layer].size - 1; 
-
-                // Add node to tree
-                struct Vector* node_layer = &ui_tree->tree_stack[current_layer+1];
-                Vector_Push(node_layer, &new_node);
-                current_node = (struct Node*) Vector_Get(node_layer, node_layer->size -1);
-                if (current_layer != -1) // Only equals -1 for the root window node (optimisation would be to remove this check and append root node at beggining of function)
+            // text continues
+            if (run_end > i)
+            {
+                // Text split by a tab or newline is no longer contiguous -> move it into the arena
+                if (parser->text_in_source && parser->text_src_index + parser->text_char_count != i)
                 {
-                    // Inform parent that parent has new child
-                    struct Node* parentNode = (struct Node*) Vector_Get(&ui_tree->tree_stack[current_layer], new_node.parent_index);
-                    if (parentNode->child_count == 0)
-                    {
-                        parentNode->first_child_index = ui_tree->tree_stack[current_layer+1].size - 1;
-                    }
-                    parentNode->child_count += 1;
-                    parentNode->child_capacity += 1;
+                    parser->text_arena_buffer_index = text_arena->char_buffer.size;
+                    Vector_Push_Range_Char(&text_arena->char_buffer, src_buffer + parser->text_src_index, parser->text_char_count);
+                    parser->text_in_source = 0;
                 }
+                if (!parser->text_in_source) {
+                    Vector_Push_Range_Char(&text_arena->char_buffer, src_buffer + i, run_end - i);
+                }
+                parser->text_char_count += run_end - i;
+            }
 
-                // Move one layer deeper
-                current_layer++;
+            i = run_end;
+            if (i == src_length) break;
 
-                ui_tree->deepest_layer = MAX(ui_tree->deepest_layer, current_layer);
+            // Tabs and newlines are not part of the text content
+            if (src_buffer[i] != '<')
+            {
+                i+=1;
+                continue;
+            }
 
-                // Increment NU_Token
-                i+=2;
+            // Need to see "<!--" or "</" -> wait for the next chunk
+            if (!is_final && i + 3 >= src_length) break;
+
+            // Comment begins
+            if (i + 3 < src_length && src_buffer[i+1] == '!' && src_buffer[i+2] == '-' && src_buffer[i+3] == '-')
+            {
+                ctx = 1;
+                i+=4;
                 continue;
             }
+
+            // Reset global text character count
+            if (parser->text_char_count > 0)
+            {
+                uint32_t buffer_index = parser->text_in_source ? parser->src_offset + parser->text_src_index : parser->text_arena_buffer_index;
+                if (NU_Push_Text_Content(parser, buffer_index, parser->text_char_count, parser->text_in_source) != 0) return -1;
+            }
+            parser->text_char_count = 0;
+
+            // Open end tag
+            if (i + 1 < src_length && src_buffer[i+1] == '/')
+            {
+                if (NU_Parser_Token(parser, OPEN_END_TAG, NULL, 0) != 0) return -1;
+                i+=2;
+            }
+
+            // Tag begins
             else
             {
-                return -1;
+                if (NU_Parser_Token(parser, OPEN_TAG, NULL, 0) != 0) return -1;
+                i+=1;
             }
+            word_char_count = 0;
+            ctx = 2;
+            continue;
         }
 
-        // Open end tag -> tag closes -> move up one layer
-        if (NU_Token == OPEN_END_TAG)
+        // In comment -> jump to the next '-' and check for the comment end
+        if (ctx == 1)
         {
-            if (current_layer < 0) break;
-            
-            // Check close grammar
-            enum Tag openTag = ((struct Node*) Vector_Get(&ui_tree->tree_stack[current_layer], ui_tree->tree_stack[current_layer].size - 1))->tag;
-            if (AssertTagCloseStartGrammar(NU_Token_vector, i, openTag) != 0)
+            i = Scan_Until(src_buffer, i, src_length, SCAN_COMMENT);
+            if (i == src_length) break;
+            if (!is_final && i + 2 >= src_length) break; // "-->" may be split across chunks
+            if (i + 2 < src_length && src_buffer[i+1] == '-' && src_buffer[i+2] == '>')
             {
-                return -1; // Failure
+                ctx = 0;
+                i+=3;
+                continue;
             }
+            i+=1;
+            continue;
+        }
+
+        // Property space -> the value runs up to the closing quote
+        if (ctx == 3)
+        {
+            uint32_t value_end = Scan_Until(src_buffer, i, src_length, SCAN_QUOTE);
+            if (value_end == src_length) break;
+            if (NU_Parser_Token(parser, PROPERTY_VALUE, src_buffer + i, value_end - i) != 0) return -1;
+            ctx = 2;
+            i = value_end + 1;
+            continue;
+        }
+
+        // Tag space -> extend the current word up to the next structural character
+        uint32_t word_end = Scan_Until(src_buffer, i, src_length, SCAN_TAG);
+        if (word_char_count == 0) word_start = i;
+        word_char_count += word_end - i;
+        i = word_end;
+        if (i == src_length) break;
+        char c = src_buffer[i];
 
-            // Move one layer higher
-            current_layer--;
+        // Need to see whether '/' is followed by '>' -> wait for the next chunk
+        if (c == '/' && !is_final && i + 1 == src_length) break;
 
-            // Increment NU_Token
-            i+=3;
+        // A '/' that does not close the tag is part of the word
+        if (c == '/' && (i + 1 == src_length || src_buffer[i+1] != '>'))
+        {
+            if (word_char_count == 0) word_start = i;
+            word_char_count += 1;
+            i+=1;
             continue;
         }
 
-        // Close end tag -> tag self closes -> move up one layer
-        if (NU_Token == CLOSE_END_TAG)
+        // Any other structural character ends the word
+        if (word_char_count > 0) {
+            enum NU_Token t = NU_Word_To_NU_Token(src_buffer + word_start, word_char_count);
+            if (NU_Parser_Token(parser, t, NULL, 0) != 0) return -1;
+        }
+        word_char_count = 0;
+
+        // Self closing end tag
+        if (c == '/')
         {
-            // Move one layer higher
-            current_layer--;
+            if (NU_Parser_Token(parser, CLOSE_END_TAG, NULL, 0) != 0) return -1;
+            ctx = 0;
+            i+=2;
+            continue;
+        }
 
-            // Increment NU_Token
+        // Tag ends
+        if (c == '>')
+        {
+            if (NU_Parser_Token(parser, CLOSE_TAG, NULL, 0) != 0) return -1;
+            ctx = 0;
             i+=1;
             continue;
         }
 
-        // Text content
-        if (NU_Token == TEXT_CONTENT)
+        // Property assignment
+        if (c == '=')
         {
-            struct Text_Ref* text_ref = (struct Text_Ref*) Vector_Get(&ui_tree->text_arena.text_refs, text_content_ref_index);
-            text_ref->node_ID = current_node_ID;
-            current_node->text_ref_index = text_content_ref_index;
-            text_content_ref_index += 1;
-
-            // Increment NU_Token
+            if (NU_Parser_Token(parser, PROPERTY_ASSIGNMENT, NULL, 0) != 0) return -1;
             i+=1;
             continue;
         }
 
-        // Property tag -> assign property to node
-        if (NU_Is_Token_Property(NU_Token))
+        // Property value begins
+        if (c == '"')
         {
-            if (AssertPropertyGrammar(NU_Token_vector, i) == 0)
-            {
-                current_property_text = Vector_Get(ptext_ref_vector, property_text_index);
-                property_text_index += 1;
-                char c = src_buffer[current_property_text->src_index];
+            ctx = 3;
+            i+=1;
+            continue;
+        }
 
-                // Get the property value text
-                switch (NU_Token)
-                {
-                    // Set layout direction
-                    case LAYOUT_DIRECTION_PROPERTY:
-                        if (c == 'h') 
-                            current_node->layout_flags |= LAYOUT_HORIZONTAL;
-                        else 
-                            current_node->layout_flags |= LAYOUT_VERTICAL;
-                        break;
-
-                    // Set growth
-                    case GROW_PROPERTY:
-                        switch(c)
-                        {
-                            case 'v':
-                                current_node->layout_flags |= GROW_VERTICAL;
-                                break;
-                            case 'h':
-                                current_node->layout_flags |= GROW_HORIZONTAL;
-                                break;
-                            case 'b':
-                                current_node->layout_flags |= (GROW_HORIZONTAL | GROW_VERTICAL);
-                                break;
-                        }
-
-                        break;
-                    
-                    // Set overflow behaviour
-                    case OVERFLOW_V_PROPERTY:
-                        if (c == 's') 
-                            current_node->layout_flags |= OVERFLOW_VERTICAL_SCROLL;
-                        break;
-                    
-                    case OVERFLOW_H_PROPERTY:
-                        if (c == 's') 
-                            current_node->layout_flags |= OVERFLOW_HORIZONTAL_SCROLL;
-                        break;
-                    
-                    // Set preferred width
-                    case WIDTH_PROPERTY:
-                        float width; 
-                        if (Property_Text_To_Float(&width, src_buffer, current_property_text) == 0) 
-                            current_node->preferred_width = width;
-                        break;
-
-                    // Set min width
-                    case MIN_WIDTH_PROPERTY:
-                        float min_width;
-                        if (Property_Text_To_Float(&min_width, src_buffer, current_property_text) == 0) 
-                            current_node->min_width = min_width;
-                        break;
-
-                    // Set max width
-                    case MAX_WIDTH_PROPERTY:
-                        float max_width;
-                        if (Property_Text_To_Float(&max_width, src_buffer, current_property_text) == 0) 
-                            current_node->max_width = max_width;
-                        break;
-
-                    // Set preferred height
-                    case HEIGHT_PROPERTY:
-                        float height;
-                        if (Property_Text_To_Float(&height, src_buffer, current_property_text) == 0) 
-                            current_node->preferred_height = height;
-                        break;
-
-                    // Set min height
-                    case MIN_HEIGHT_PROPERTY:
-                        float min_height;
-                        if (Property_Text_To_Float(&min_height, src_buffer, current_property_text) == 0) 
-                            current_node->min_height = min_height;
-                        break;
-
-                    // Set max height
-                    case MAX_HEIGHT_PROPERTY:
-                        float max_height;
-                        if (Property_Text_To_Float(&max_height, src_buffer, current_property_text) == 0) {
-                            current_node->min_height = max_height;
-                        }
-                        break;
-
-                    // Set horizontal alignment
-                    case ALIGN_H_PROPERTY:
-                        char* ptext = &src_buffer[current_property_text->src_index];
-                        if (memcmp(ptext, "left", 4) == 0) {
-                            current_node->horizontal_alignment = 0;
-                        } else if (memcmp(ptext, "center", 6) == 0) {
-                            current_node->horizontal_alignment = 1;
-                        } else if (memcmp(ptext, "right", 5) == 0) {
-                            current_node->horizontal_alignment = 2;
-                        }
-                        break;
-
-                    // Set vertical alignment
-                    case ALIGN_V_PROPERTY:
-                        if (memcmp(ptext, "left", 4) == 0) {
-                            current_node->vertical_alignment = 0;
-                        } else if (memcmp(ptext, "center", 6) == 0) {
-                            current_node->vertical_alignment = 1;
-                        } else if (memcmp(ptext, "right", 5) == 0) {
-                            current_node->vertical_alignment = 2;
-                        }
-                        break;
-                        
-                    default:
-                        break;
-                }
+        // Split character
+        i+=1;
+    }
 
-                // Increment NU_Token
-                i+=3;
-                continue;
-            }
-            else {
-                return -1;
-            }
+    // Partial word at the end of the chunk -> leave it unconsumed
+    if (ctx == 2 && word_char_count > 0)
+    {
+        if (!is_final) {
+            i = word_start;
+        } else {
+            enum NU_Token t = NU_Word_To_NU_Token(src_buffer + word_start, word_char_count);
+            if (NU_Parser_Token(parser, t, NULL, 0) != 0) return -1;
         }
-        i+= 1;
     }
+
+    parser->ctx = ctx;
+    *consumed_out = MIN(i, src_length);
     return 0; // Success
 }
 
+// The text vectors are reserved in proportion to the source length, the layers start small and grow
+// (the region reallocs large blocks, so a big layer grows like a heap vector)
+#define NU_SRC_BYTES_PER_TEXT_REF 128
+#define NU_SRC_BYTES_PER_TEXT_CHAR 64
+#define NU_UI_TREE_REGION_CHUNK 8192 // fits the initial reservations of a small tree
+#define NU_REGION_BYTES_PER_SRC_BYTE 4 // the first chunk grows with the source so small blocks rarely need another
+#define NU_UI_TREE_MAX_FIRST_CHUNK (1u << 20)
+
+static void NU_Reserve_UI_Tree_Vectors(struct UI_Tree* ui_tree, uint32_t src_length)
+{
+    struct Region* region = &ui_tree->region;
+
+    // Init text arena vectors
+    for (int c=0; c<NU_TEXT_SIZE_CLASSES; c++) {
+        Vector_Reserve_Region(&ui_tree->text_arena.free_lists[c], region, sizeof(struct Arena_Free_Element), 4);
+    }
+    ui_tree->text_arena.free_chars = 0;
+    Vector_Reserve_Region(&ui_tree->text_arena.text_refs, region, sizeof(struct Text_Ref), MAX(src_length / NU_SRC_BYTES_PER_TEXT_REF, 16));
+    Vector_Reserve_Region(&ui_tree->text_arena.char_buffer, region, sizeof(char), MAX(src_length / NU_SRC_BYTES_PER_TEXT_CHAR, 256));
+    Vector_Reserve_Region(&ui_tree->text_arena.rows, region, sizeof(struct Text_Row), 16);
+    ui_tree->text_arena.free_rows = 0;
+    ui_tree->text_arena.generation = 0;
+    Vector_Reserve_Region(&ui_tree->text_arena.block_generations, region, sizeof(uint32_t), 16);
+
+    // Root layer and the empty layer below it, deeper layers are added as the tree deepens
+    ui_tree->tree_stack = NULL;
+    ui_tree->cold_stack = NULL;
+    ui_tree->free_slots = NULL;
+    ui_tree->layer_generations = NULL;
+    ui_tree->layer_count = 0;
+    ui_tree->layer_capacity = 0;
+    NU_Reserve_Layers(ui_tree, 2);
+    Vector_Reserve_Region(&ui_tree->handles, region, sizeof(struct Node_Handle_Slot), 16);
+    ui_tree->free_handle = UINT32_MAX;
+    ui_tree->id_generation = 0;
+    Vector_Reserve_Region(&ui_tree->id_chars, region, sizeof(char), 256);
+    Vector_Reserve_Region(&ui_tree->id_table, region, sizeof(struct Id_Slot), NU_ID_TABLE_MIN_SIZE);
+    NU_Clear_Id_Table(ui_tree, NU_ID_TABLE_MIN_SIZE);
+    ui_tree->deepest_layer = 0;
+}
+
+// src_length sizes the first region chunk and the text reservations (0 if unknown)
+static void NU_Init_UI_Tree_Memory(struct UI_Tree* ui_tree, uint32_t src_length)
+{
+    Region_Init(&ui_tree->region, MIN(NU_UI_TREE_REGION_CHUNK + (size_t) src_length * NU_REGION_BYTES_PER_SRC_BYTE, NU_UI_TREE_MAX_FIRST_CHUNK));
+    NU_Reserve_UI_Tree_Vectors(ui_tree, src_length);
+    ui_tree->src_file.data = NULL;
+    ui_tree->src_file.length = 0;
+    ui_tree->bin_file.data = NULL;
+    ui_tree->bin_file.length = 0;
+    ui_tree->layout_pool = NULL;
+}
+
+// Resets the parser state for a tree whose memory is already initialised
+static void NU_Parser_Reset(struct NU_Parser* parser, struct UI_Tree* ui_tree)
+{
+    parser->ui_tree = ui_tree;
+    parser->current_layer = -1;
+    parser->grammar = GRAMMAR_ROOT;
+    parser->pending_property = UNDEFINED;
+    parser->ctx = 0;
+    parser->src_persistent = 0;
+    parser->src_offset = 0;
+    parser->text_in_source = 0;
+    parser->text_arena_buffer_index = 0;
+    parser->text_src_index = 0;
+    parser->text_char_count = 0;
+    parser->tokenise_only = 0;
+    parser->token_count = 0;
+    Vector_Reserve(&parser->carry, sizeof(char), 256);
+    parser->carry_tried = 0;
+}
+
+static void NU_Parser_Init(struct NU_Parser* parser, struct UI_Tree* ui_tree, uint32_t src_length)
+{
+    NU_Init_UI_Tree_Memory(ui_tree, src_length);
+    NU_Parser_Reset(parser, ui_tree);
+}
+
+static int NU_Parser_Finish(struct NU_Parser* parser)
+{
+    Vector_Free(&parser->carry);
+    if (parser->grammar == GRAMMAR_ERROR) return -1;
+
+    // ENFORCE RULE: THE ROOT WINDOW MUST BE CLOSED
+    if (parser->grammar != GRAMMAR_DONE)
+    {
+        if (parser->grammar == GRAMMAR_ROOT) printf("%s\n", "[Generate_Tree] Error! XML tree has no root. XML documents must begin with a <window> tag.");
+        else printf("%s\n", "[Generate_Tree] Error! XML tree root not closed.");
+        return -1;
+    }
+    return 0; // Success
+}
+
+// Parses an in memory XML source into the UI tree. The src buffer must outlive the tree (text refs point into it).
+static int NU_Parse_Source(char* src_buffer, uint32_t src_length, struct UI_Tree* ui_tree)
+{
+    struct NU_Parser parser;
+    NU_Parser_Init(&parser, ui_tree, src_length);
+    parser.src_persistent = 1;
+    uint32_t consumed;
+    if (NU_Tokenise(src_buffer, src_length, &parser, 1, &consumed) != 0) parser.grammar = GRAMMAR_ERROR;
+    return NU_Parser_Finish(&parser);
+}
+
 // Internal Functions ----------- //
 
 
@@ -812,59 +1483,257 @@ static int NU_Generate_Tree(char* src_buffer, uint32_t src_length, struct UI_Tre
 
 int NU_Parse(char* filepath, struct UI_Tree* ui_tree)
 {
-    // Open XML source file and load into buffer
-    FILE* f = fopen(filepath, "r");
-    if (!f) {
-        fprintf(stderr, "Cannot open file '%s': %s\n", filepath, strerror(errno));
+    // Map the XML source file (text refs and property values point straight into it)
+    struct File_Map src_file;
+    if (File_Map_Open(filepath, &src_file) != 0) {
         return -1;
     }
-    fseek(f, 0, SEEK_END);
-    long file_size_long = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    if (file_size_long > UINT32_MAX) {
-        printf("%s", "Src file is too large! It must be < 4 294 967 295 Bytes");
-        return -1;
+
+    // Tokenise the file source and build the UI tree in a single pass
+    if (NU_Parse_Source(src_file.data, src_file.length, ui_tree) != 0) 
+    {
+        File_Map_Close(&src_file);
+        return -1; // Failure
     }
-    uint32_t src_length = (uint32_t)file_size_long;
-    char* src_buffer = malloc(src_length + 1);
-    src_length = fread(src_buffer, 1, file_size_long, f);
-    src_buffer[src_length] = '\0'; 
-    fclose(f);
+    ui_tree->src_file = src_file;
+    return 0; // Success
+}
+
+// Streaming parser: NU_Parse_Begin -> NU_Parse_Feed (any number of arbitrarily sized chunks) -> NU_Parse_End.
+// Nodes are built as each chunk arrives. Chunks may be freed once fed, text content is copied into the arena.
+void NU_Parse_Begin(struct NU_Parser* parser, struct UI_Tree* ui_tree)
+{
+    NU_Parser_Init(parser, ui_tree, 0);
+}
+
+static int NU_Parse_Carry_Error(struct NU_Parser* parser)
+{
+    printf("%s %d %s\n", "[Generate Tree] Error! A word, property value or tag is longer than", NU_MAX_CARRY, "bytes");
+    parser->grammar = GRAMMAR_ERROR;
+    return -1; // Failure
+}
+
+int NU_Parse_Feed(struct NU_Parser* parser, const char* chunk, uint32_t chunk_length)
+{
+    if (parser->grammar == GRAMMAR_ERROR) return -1;
+    uint32_t offset = 0;
+    uint32_t consumed;
 
-    // Init Token vector and reserve ~1MB
-    struct Vector NU_Token_vector;
-    struct Vector ptext_ref_vector;
+    // Finish the token carried over from the previous chunk. The carry is only tokenised again once it has
+    // doubled, so a token spread over many small chunks costs O(length) rather than a pass per chunk.
+    while (parser->carry.size > 0 && offset < chunk_length)
+    {
+        uint32_t carried = parser->carry.size;
+        uint32_t retry_size = MAX(parser->carry_tried * 2, parser->carry_tried + 256);
+        uint32_t top_up = MIN(chunk_length - offset, retry_size - carried);
+        Vector_Push_Range(&parser->carry, chunk + offset, top_up);
+        if (parser->carry.size < retry_size) // chunk used up -> wait for more
+        {
+            offset += top_up;
+            if (parser->carry.size > NU_MAX_CARRY) return NU_Parse_Carry_Error(parser);
+            break;
+        }
+        if (NU_Tokenise(parser->carry.data, parser->carry.size, parser, 0, &consumed) != 0) return -1;
+        if (consumed >= carried) // tokeniser moved past the carried bytes -> continue in the chunk itself
+        {
+            offset += consumed - carried;
+            parser->carry.size = 0;
+        }
+        else // token is still incomplete -> keep the unconsumed part
+        {
+            memmove(parser->carry.data, (char*) parser->carry.data + consumed, parser->carry.size - consumed);
+            parser->carry.size -= consumed;
+            parser->carry_tried = parser->carry.size;
+            offset += top_up;
+            if (parser->carry.size > NU_MAX_CARRY) return NU_Parse_Carry_Error(parser);
+        }
+    }
+    if (offset == chunk_length) return 0;
 
-    // Init vectors
-    Vector_Reserve(&NU_Token_vector, sizeof(enum NU_Token), 250000); // reserve ~1MB
-    Vector_Reserve(&ptext_ref_vector, sizeof(struct Property_Text_Ref), 100000); // reserve ~900KB
-    Vector_Reserve(&ui_tree->text_arena.free_list, sizeof(struct Arena_Free_Element), 100000); // reserve ~800KB
-    Vector_Reserve(&ui_tree->text_arena.text_refs, sizeof(struct Text_Ref), 100000); // reserve ~800KB
-    Vector_Reserve(&ui_tree->text_arena.char_buffer, sizeof(char), 1000000); // reserve ~1MB
+    // Tokenise the rest of the chunk in place and carry whatever is left over
+    if (NU_Tokenise((char*) chunk + offset, chunk_length - offset, parser, 0, &consumed) != 0) return -1;
+    if (chunk_length - offset - consumed > NU_MAX_CARRY) return NU_Parse_Carry_Error(parser);
+    Vector_Push_Range(&parser->carry, chunk + offset + consumed, chunk_length - offset - consumed);
+    parser->carry_tried = parser->carry.size;
+    return 0; // Success
+}
 
-    // Init UI tree layers -> reserve 100 nodes per stack layer = 384KB
-    Vector_Reserve(&ui_tree->tree_stack[0], sizeof(struct Node), 1); // 1 root element
-    for (int i=1; i<MAX_TREE_DEPTH; i++) {
-        Vector_Reserve(&ui_tree->tree_stack[i], sizeof(struct Node), 100);
+int NU_Parse_End(struct NU_Parser* parser)
+{
+    uint32_t consumed;
+    if (parser->grammar != GRAMMAR_ERROR && parser->carry.size > 0) {
+        NU_Tokenise(parser->carry.data, parser->carry.size, parser, 1, &consumed);
     }
+    return NU_Parser_Finish(parser);
+}
 
-    // Tokenise the file source
-    NU_Tokenise(src_buffer, src_length, &NU_Token_vector, &ptext_ref_vector, &ui_tree->text_arena);
+int NU_Parse_Buffer(const char* buffer, uint32_t length, struct UI_Tree* ui_tree)
+{
+    struct NU_Parser parser;
+    NU_Parse_Begin(&parser, ui_tree);
+    NU_Parse_Feed(&parser, buffer, length);
+    return NU_Parse_End(&parser);
+}
 
-    // Generate UI tree
-    if (NU_Generate_Tree(src_buffer, src_length, ui_tree, &NU_Token_vector, &ptext_ref_vector) != 0) return -1; // Failure
+// Parses from a stream (e.g. a pipe from another process) as the bytes arrive
+int NU_Parse_Stream(FILE* stream, struct UI_Tree* ui_tree)
+{
+    char chunk[65536];
+    struct NU_Parser parser;
+    NU_Parse_Begin(&parser, ui_tree);
+    size_t chunk_length;
+    while ((chunk_length = fread(chunk, 1, sizeof(chunk), stream)) > 0) {
+        if (NU_Parse_Feed(&parser, chunk, (uint32_t) chunk_length) != 0) break;
+    }
+    return NU_Parse_End(&parser);
+}
 
-    // Free token and property text reference memory
-    Vector_Free(&NU_Token_vector);
-    Vector_Free(&ptext_ref_vector);
+// Writes the current ID of the node with the id attribute. Returns -1 if no node has the id.
+int NU_Get_Node_By_Id(struct UI_Tree* ui_tree, const char* id, uint32_t* node_ID_out)
+{
+    int found = NU_Id_Table_Find(ui_tree, id, NU_Id_Hash(id, strlen(id)));
+    if (found == -1) return -1;
+    struct Id_Slot* id_slot = Vector_Get(&ui_tree->id_table, found);
+    struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, id_slot->handle.index);
+    if (slot->generation != id_slot->handle.generation) return -1;
+    *node_ID_out = slot->node_ID;
     return 0; // Success
 }
 
+char* NU_Text_Ref_Chars(struct UI_Tree* ui_tree, struct Text_Ref* text_ref)
+{
+    if (text_ref->in_source) return ui_tree->src_file.data + text_ref->buffer_index;
+    return (char*) ui_tree->text_arena.char_buffer.data + text_ref->buffer_index;
+}
+
+struct NU_Text_Position
+{
+    uint32_t buffer_index;
+    uint32_t ref_index;
+};
+
+static int NU_Compare_Text_Positions(const void* a, const void* b)
+{
+    uint32_t index_a = ((const struct NU_Text_Position*) a)->buffer_index;
+    uint32_t index_b = ((const struct NU_Text_Position*) b)->buffer_index;
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+// Packs the arena text back to back in place (each text's capacity shrinks to its length) and empties the
+// free lists. Pointers from NU_Text_Ref_Chars are invalid afterwards.
+void NU_Compact_Text_Arena(struct UI_Tree* ui_tree)
+{
+    struct Text_Arena* text_arena = &ui_tree->text_arena;
+
+    // Slide the blocks down in buffer order so no text is overwritten before it moves
+    struct NU_Text_Position* positions = malloc(MAX(text_arena->text_refs.size, 1) * sizeof(struct NU_Text_Position));
+    uint32_t position_count = 0;
+    for (uint32_t i=0; i<text_arena->text_refs.size; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&text_arena->text_refs, i);
+        if (text_ref->in_source) continue;
+        positions[position_count].buffer_index = text_ref->buffer_index;
+        positions[position_count].ref_index = i;
+        position_count += 1;
+    }
+    qsort(positions, position_count, sizeof(struct NU_Text_Position), NU_Compare_Text_Positions);
+
+    char* chars = text_arena->char_buffer.data;
+    uint32_t write_index = 0;
+    for (uint32_t i=0; i<position_count; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get_Text_Ref(&text_arena->text_refs, positions[i].ref_index);
+        memmove(chars + write_index, chars + text_ref->buffer_index, text_ref->char_count);
+        chars[write_index + text_ref->char_count] = '\0';
+        text_ref->buffer_index = write_index;
+        text_ref->char_capacity = text_ref->char_count;
+        write_index += text_ref->char_count + 1;
+    }
+    text_arena->char_buffer.size = write_index;
+    free(positions);
+    NU_Clear_Text_Free_Lists(text_arena);
+    NU_Touch_Text(text_arena, 0, write_index);
+}
+
+// Copies the text that is still referenced in the source file into the arena and unmaps the file, so the tree
+// no longer depends on the source (it can be edited in place, copied or the file rewritten)
+static void NU_Detach_Source_Text(struct UI_Tree* ui_tree)
+{
+    if (ui_tree->src_file.data == NULL) return;
+    struct Vector* text_refs = &ui_tree->text_arena.text_refs;
+    struct Vector* char_buffer = &ui_tree->text_arena.char_buffer;
+    uint32_t old_size = char_buffer->size;
+    for (uint32_t i=0; i<text_refs->size; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get(text_refs, i);
+        if (!text_ref->in_source) continue;
+        char null_terminator = '\0';
+        uint32_t buffer_index = char_buffer->size;
+        Vector_Push_Range(char_buffer, ui_tree->src_file.data + text_ref->buffer_index, text_ref->char_count);
+        Vector_Push(char_buffer, &null_terminator);
+        text_ref->buffer_index = buffer_index;
+        text_ref->char_capacity = text_ref->char_count;
+        text_ref->in_source = 0;
+    }
+    NU_Touch_Text(&ui_tree->text_arena, old_size, char_buffer->size);
+    File_Map_Close(&ui_tree->src_file);
+}
+
+// Sets the node's NU_DIRTY_SELF bit and NU_DIRTY_CHILD on its ancestors (without touching the layer)
+static void NU_Mark_Dirty_Path(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    int layer = node_ID >> 24;
+    struct Node* node = Vector_Get_Node(&ui_tree->tree_stack[layer], node_ID & 0x00FFFFFF);
+    node->dirty |= NU_DIRTY_SELF;
+    while (layer > 0)
+    {
+        layer -= 1;
+        node = Vector_Get_Node(&ui_tree->tree_stack[layer], node->parent_index);
+        if (node->dirty & (NU_DIRTY_CHILD | NU_DIRTY_ALL)) return; // the rest of the path is marked already
+        node->dirty |= NU_DIRTY_CHILD;
+    }
+}
+
+// Marks a node whose text, size properties or child list changed so the next NU_Render lays it out again
+// (its ancestors are marked too, the passes only visit marked nodes and the nodes whose size or position they change)
+void NU_Mark_Node_Dirty(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    NU_Touch_Layer(ui_tree, node_ID >> 24);
+    NU_Mark_Dirty_Path(ui_tree, node_ID);
+}
+
+// Lays out the whole tree on the next NU_Render (windows resized, layers replaced or copied in)
+void NU_Mark_Tree_Dirty(struct UI_Tree* ui_tree)
+{
+    if (ui_tree->tree_stack[0].size == 0) return;
+    Vector_Get_Node(&ui_tree->tree_stack[0], 0)->dirty |= NU_DIRTY_ALL;
+}
+
+// Records a change to everything in the tree (layers, handles, ids and text replaced wholesale)
+static void NU_Touch_Tree(struct UI_Tree* ui_tree)
+{
+    for (uint32_t l=0; l<ui_tree->layer_count; l++) {
+        NU_Touch_Layer(ui_tree, l);
+    }
+    ui_tree->id_generation += 1;
+    NU_Touch_Text(&ui_tree->text_arena, 0, ui_tree->text_arena.char_buffer.size);
+}
+
+// Frees every vector of the tree at once (its region) and unmaps the source and precompiled files
 void NU_Free_UI_Tree_Memory(struct UI_Tree* ui_tree)
 {
-    Vector_Free(&ui_tree->text_arena.free_list);
-    Vector_Free(&ui_tree->text_arena.text_refs);
-    Vector_Free(&ui_tree->text_arena.char_buffer);
+    Region_Free(&ui_tree->region);
+    File_Map_Close(&ui_tree->src_file);
+    File_Map_Close(&ui_tree->bin_file);
+}
+
+// Empties the tree for reuse: the region keeps its largest chunk so a tree of similar size needs no new memory
+void NU_Reset_UI_Tree_Memory(struct UI_Tree* ui_tree, uint32_t src_length)
+{
+    File_Map_Close(&ui_tree->src_file);
+    File_Map_Close(&ui_tree->bin_file);
+    Region_Reset(&ui_tree->region);
+    NU_Reserve_UI_Tree_Vectors(ui_tree, src_length);
 }
 
 // Public Functions ------------- //
\ No newline at end of file
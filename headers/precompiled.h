@@ -0,0 +1,376 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+#include "file_map.h"
+
+// Precompiled UI files: a fully built UI_Tree written straight to disk so startup skips tokenising and validation.
+// The file is mapped copy on write and the tree's layers, text, handles and ids are used from the mapping in
+// place, so a load costs the mapping and a few pointers. A vector is only copied into the tree's region the first
+// time it has to grow (see NU_Borrow_Vector).
+//
+// Layout (native byte order, the file is only valid for the build that wrote it). Every section starts
+// NU_PRECOMPILED_ALIGN aligned (zero padded), so the nodes can be used where they are mapped:
+//   struct NU_Precompiled_Header
+//   layer sizes                               (header.deepest_layer + 1 uint32_t)
+//   tree_stack layers 0..deepest_layer        (layer_sizes[i] nodes each)
+//   cold_stack layers 0..deepest_layer        (layer_sizes[i] cold nodes each)
+//   text refs                                 (header.text_ref_count refs)
+//   text chars                                (header.char_count chars, every text is null terminated)
+//   id chars                                  (header.id_char_count chars)
+//   id table                                  (header.id_table_size slots)
+//   handles                                   (header.handle_count slots)
+
+#define NU_PRECOMPILED_MAGIC   0x42554E4E   // "NNUB"
+#define NU_PRECOMPILED_VERSION 7
+#define NU_PRECOMPILED_ALIGN   16
+
+struct NU_Precompiled_Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t src_hash;
+    uint64_t src_mtime;      // modification time of the source when it was hashed (see NU_Precompiled_Source_Stamp)
+    uint32_t src_length;
+    uint32_t node_size;      // sizeof(struct Node), sizeof(struct Node_Cold) and sizeof(struct Text_Ref) of the writer
+    uint32_t node_cold_size; // -> rejects files written by a build with a different struct layout
+    uint32_t text_ref_size;
+    uint32_t deepest_layer;
+    uint32_t text_ref_count;
+    uint32_t char_count;
+    uint32_t id_char_count;
+    uint32_t id_table_size;
+    uint32_t id_count;
+    uint32_t handle_count;
+    uint32_t free_handle;
+};
+
+static uint64_t NU_Precompiled_Align(uint64_t offset)
+{
+    return (offset + NU_PRECOMPILED_ALIGN - 1) & ~(uint64_t) (NU_PRECOMPILED_ALIGN - 1);
+}
+
+// Size and modification time of the XML source (100 ns ticks on Windows, nanoseconds elsewhere). A source
+// whose stamp matches the precompiled file's is not hashed. Returns -1 if the file can't be found.
+static int NU_Precompiled_Source_Stamp(const char* src_filepath, uint64_t* mtime_out, uint64_t* size_out)
+{
+    #ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(src_filepath, GetFileExInfoStandard, &data)) return -1;
+    *mtime_out = ((uint64_t) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    *size_out = ((uint64_t) data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    #else
+    struct stat st;
+    if (stat(src_filepath, &st) != 0) return -1;
+    #if defined(__APPLE__)
+    *mtime_out = (uint64_t) st.st_mtimespec.tv_sec * 1000000000ull + (uint64_t) st.st_mtimespec.tv_nsec;
+    #elif defined(st_mtime) // st_mtime is st_mtim.tv_sec when the nanosecond time is there (glibc, musl)
+    *mtime_out = (uint64_t) st.st_mtim.tv_sec * 1000000000ull + (uint64_t) st.st_mtim.tv_nsec;
+    #else
+    *mtime_out = (uint64_t) st.st_mtime * 1000000000ull;
+    #endif
+    *size_out = (uint64_t) st.st_size;
+    #endif
+    return 0; // Success
+}
+
+// Hashes the XML source 8 bytes at a time (only when its stamp changed, but then on every launch until it is rewritten)
+static uint64_t NU_Precompiled_Source_Hash(const char* src, uint32_t length)
+{
+    uint64_t h = 14695981039346656037ull ^ length;
+    uint32_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, 8);
+        h = (h ^ word) * 1099511628211ull;
+        h ^= h >> 29;
+    }
+    for (; i < length; i++) {
+        h = (h ^ (uint8_t) src[i]) * 1099511628211ull;
+    }
+    return h ^ (h >> 32);
+}
+
+// Zero pads the file up to the next section start
+static void NU_Write_Precompiled_Padding(FILE* f, uint64_t* offset)
+{
+    static const char zeros[NU_PRECOMPILED_ALIGN] = { 0 };
+    uint64_t aligned = NU_Precompiled_Align(*offset);
+    fwrite(zeros, 1, aligned - *offset, f);
+    *offset = aligned;
+}
+
+static void NU_Write_Precompiled_Section(FILE* f, const void* data, size_t size, uint64_t* offset)
+{
+    fwrite(data, 1, size, f);
+    *offset += size;
+    NU_Write_Precompiled_Padding(f, offset);
+}
+
+// Writes to a temporary file that then replaces the old one, so a tree still mapped from the old file keeps
+// its pages (on Windows the old file can't be replaced while it is mapped -> the write fails instead)
+static int NU_Write_Precompiled(struct UI_Tree* ui_tree, uint64_t src_hash, uint32_t src_length, uint64_t src_mtime, char* bin_filepath)
+{
+    size_t path_length = strlen(bin_filepath);
+    char* temp_filepath = malloc(path_length + 5);
+    memcpy(temp_filepath, bin_filepath, path_length);
+    memcpy(temp_filepath + path_length, ".tmp", 5);
+    FILE* f = fopen(temp_filepath, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot open file '%s': %s\n", temp_filepath, strerror(errno));
+        free(temp_filepath);
+        return -1;
+    }
+
+    // Text that is referenced in place lives in the src file -> it is appended after the arena chars
+    struct Vector* text_refs = &ui_tree->text_arena.text_refs;
+    struct Vector* char_buffer = &ui_tree->text_arena.char_buffer;
+    uint32_t char_count = char_buffer->size;
+    for (uint32_t i=0; i<text_refs->size; i++) {
+        struct Text_Ref* text_ref = Vector_Get(text_refs, i);
+        if (text_ref->in_source) char_count += text_ref->char_count + 1;
+    }
+
+    struct NU_Precompiled_Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = NU_PRECOMPILED_MAGIC;
+    header.version = NU_PRECOMPILED_VERSION;
+    header.src_hash = src_hash;
+    header.src_mtime = src_mtime;
+    header.src_length = src_length;
+    header.node_size = sizeof(struct Node);
+    header.node_cold_size = sizeof(struct Node_Cold);
+    header.text_ref_size = sizeof(struct Text_Ref);
+    header.deepest_layer = ui_tree->deepest_layer;
+    header.text_ref_count = text_refs->size;
+    header.char_count = char_count;
+    header.id_char_count = ui_tree->id_chars.size;
+    header.id_table_size = ui_tree->id_table.size;
+    header.id_count = ui_tree->id_count;
+    header.handle_count = ui_tree->handles.size;
+    header.free_handle = ui_tree->free_handle;
+    uint64_t offset = 0;
+    fwrite(&header, sizeof(header), 1, f);
+    offset += sizeof(header);
+    for (uint32_t l=0; l<=ui_tree->deepest_layer; l++) {
+        fwrite(&ui_tree->tree_stack[l].size, sizeof(uint32_t), 1, f);
+        offset += sizeof(uint32_t);
+    }
+    NU_Write_Precompiled_Padding(f, &offset);
+
+    // Nodes, then cold nodes (window and nanovg pointers are only valid in the running process)
+    for (uint32_t l=0; l<=ui_tree->deepest_layer; l++)
+    {
+        NU_Write_Precompiled_Section(f, ui_tree->tree_stack[l].data, (size_t) ui_tree->tree_stack[l].size * sizeof(struct Node), &offset);
+    }
+    for (uint32_t l=0; l<=ui_tree->deepest_layer; l++)
+    {
+        for (uint32_t n=0; n<ui_tree->cold_stack[l].size; n++)
+        {
+            struct Node_Cold cold = *(struct Node_Cold*) Vector_Get(&ui_tree->cold_stack[l], n);
+            cold.window = NULL;
+            cold.vg = NULL;
+            fwrite(&cold, sizeof(struct Node_Cold), 1, f);
+        }
+        offset += (uint64_t) ui_tree->cold_stack[l].size * sizeof(struct Node_Cold);
+        NU_Write_Precompiled_Padding(f, &offset);
+    }
+
+    // Text refs -> every ref is rewritten to point into the written char section
+    uint32_t appended_index = char_buffer->size;
+    for (uint32_t i=0; i<text_refs->size; i++)
+    {
+        struct Text_Ref text_ref = *(struct Text_Ref*) Vector_Get(text_refs, i);
+        if (text_ref.in_source) {
+            text_ref.buffer_index = appended_index;
+            text_ref.in_source = 0;
+            appended_index += text_ref.char_count + 1;
+        }
+        text_ref.measured_font = -1; // the reading build measures with its own fonts
+        text_ref.row_count = 0;
+        text_ref.row_capacity = 0;
+        fwrite(&text_ref, sizeof(struct Text_Ref), 1, f);
+    }
+    offset += (uint64_t) text_refs->size * sizeof(struct Text_Ref);
+    NU_Write_Precompiled_Padding(f, &offset);
+
+    // Text chars
+    fwrite(char_buffer->data, 1, char_buffer->size, f);
+    for (uint32_t i=0; i<text_refs->size; i++)
+    {
+        struct Text_Ref* text_ref = Vector_Get(text_refs, i);
+        if (!text_ref->in_source) continue;
+        fwrite(NU_Text_Ref_Chars(ui_tree, text_ref), 1, text_ref->char_count, f);
+        fputc('\0', f);
+    }
+    offset += char_count;
+    NU_Write_Precompiled_Padding(f, &offset);
+    NU_Write_Precompiled_Section(f, ui_tree->id_chars.data, ui_tree->id_chars.size, &offset);
+    NU_Write_Precompiled_Section(f, ui_tree->id_table.data, (size_t) ui_tree->id_table.size * sizeof(struct Id_Slot), &offset);
+    NU_Write_Precompiled_Section(f, ui_tree->handles.data, (size_t) ui_tree->handles.size * sizeof(struct Node_Handle_Slot), &offset);
+
+    int failed = ferror(f);
+    failed |= fclose(f) != 0;
+    #ifdef _WIN32
+    if (!failed) remove(bin_filepath); // rename does not replace an existing file on Windows
+    #endif
+    if (failed || rename(temp_filepath, bin_filepath) != 0) {
+        printf("[Precompiled] Error! Could not write '%s'\n", bin_filepath);
+        remove(temp_filepath);
+        free(temp_filepath);
+        return -1;
+    }
+    free(temp_filepath);
+    return 0; // Success
+}
+
+// The vector uses count elements of the mapped file in place. It stays a region vector of the tree: growing it
+// copies it into the region (Region_Realloc copies any block that isn't one of its own) and freeing it is a no-op.
+static void NU_Borrow_Vector(struct Vector* vector, const char* data, uint32_t count)
+{
+    Vector_Free(vector); // gives the reserved block back
+    vector->data = (void*) data;
+    vector->size = count;
+    vector->capacity = count;
+}
+
+// Points the UI tree's layers and text into a precompiled file mapped with File_Map_Open_Private (the mapping
+// has to outlive the tree, see NU_Load_Precompiled). Returns -1 if the file does not fit this build.
+static int NU_Read_Precompiled(struct File_Map* bin_file, struct UI_Tree* ui_tree)
+{
+    if (bin_file->length < sizeof(struct NU_Precompiled_Header)) return -1;
+    struct NU_Precompiled_Header header;
+    memcpy(&header, bin_file->data, sizeof(header));
+    if (header.magic != NU_PRECOMPILED_MAGIC || header.version != NU_PRECOMPILED_VERSION) return -1;
+    if (header.node_size != sizeof(struct Node) || header.node_cold_size != sizeof(struct Node_Cold)) return -1;
+    if (header.text_ref_size != sizeof(struct Text_Ref)) return -1;
+    if (header.deepest_layer >= MAX_TREE_DEPTH) return -1;
+    if (header.id_table_size < NU_ID_TABLE_MIN_SIZE || (header.id_table_size & (header.id_table_size - 1)) != 0) return -1;
+
+    // Check the file holds everything the header promises before touching the tree
+    uint32_t layer_sizes[MAX_TREE_DEPTH];
+    uint64_t expected_length = sizeof(header) + (uint64_t) (header.deepest_layer + 1) * sizeof(uint32_t);
+    if (bin_file->length < expected_length) return -1;
+    memcpy(layer_sizes, bin_file->data + sizeof(header), (header.deepest_layer + 1) * sizeof(uint32_t));
+    uint64_t layer_offsets[MAX_TREE_DEPTH];
+    uint64_t cold_offsets[MAX_TREE_DEPTH];
+    expected_length = NU_Precompiled_Align(expected_length);
+    for (uint32_t l=0; l<=header.deepest_layer; l++) {
+        layer_offsets[l] = expected_length;
+        expected_length = NU_Precompiled_Align(expected_length + (uint64_t) layer_sizes[l] * sizeof(struct Node));
+    }
+    for (uint32_t l=0; l<=header.deepest_layer; l++) {
+        cold_offsets[l] = expected_length;
+        expected_length = NU_Precompiled_Align(expected_length + (uint64_t) layer_sizes[l] * sizeof(struct Node_Cold));
+    }
+    uint64_t text_ref_offset = expected_length;
+    expected_length = NU_Precompiled_Align(expected_length + (uint64_t) header.text_ref_count * sizeof(struct Text_Ref));
+    uint64_t char_offset = expected_length;
+    expected_length = NU_Precompiled_Align(expected_length + header.char_count);
+    uint64_t id_char_offset = expected_length;
+    expected_length = NU_Precompiled_Align(expected_length + header.id_char_count);
+    uint64_t id_table_offset = expected_length;
+    expected_length = NU_Precompiled_Align(expected_length + (uint64_t) header.id_table_size * sizeof(struct Id_Slot));
+    uint64_t handle_offset = expected_length;
+    expected_length = NU_Precompiled_Align(expected_length + (uint64_t) header.handle_count * sizeof(struct Node_Handle_Slot));
+    if (expected_length != bin_file->length) return -1;
+
+    // The layers and text stay in the mapping
+    NU_Init_UI_Tree_Memory(ui_tree, 0);
+    NU_Reserve_Layers(ui_tree, header.deepest_layer + 2);
+    for (uint32_t l=0; l<=header.deepest_layer; l++)
+    {
+        NU_Borrow_Vector(&ui_tree->tree_stack[l], bin_file->data + layer_offsets[l], layer_sizes[l]);
+        NU_Borrow_Vector(&ui_tree->cold_stack[l], bin_file->data + cold_offsets[l], layer_sizes[l]);
+    }
+    NU_Borrow_Vector(&ui_tree->text_arena.text_refs, bin_file->data + text_ref_offset, header.text_ref_count);
+    NU_Borrow_Vector(&ui_tree->text_arena.char_buffer, bin_file->data + char_offset, header.char_count);
+    NU_Borrow_Vector(&ui_tree->id_chars, bin_file->data + id_char_offset, header.id_char_count);
+    NU_Borrow_Vector(&ui_tree->id_table, bin_file->data + id_table_offset, header.id_table_size);
+    NU_Borrow_Vector(&ui_tree->handles, bin_file->data + handle_offset, header.handle_count);
+    ui_tree->id_count = header.id_count;
+    ui_tree->free_handle = header.free_handle;
+    ui_tree->deepest_layer = header.deepest_layer;
+    NU_Mark_Tree_Dirty(ui_tree);
+    return 0; // Success
+}
+
+// Writes a built UI tree to a precompiled file for the XML source it was parsed from
+int NU_Save_Precompiled(struct UI_Tree* ui_tree, char* src_filepath, char* bin_filepath)
+{
+    uint64_t src_mtime, src_size;
+    if (NU_Precompiled_Source_Stamp(src_filepath, &src_mtime, &src_size) != 0) src_mtime = 0;
+    struct File_Map src_file;
+    if (File_Map_Open(src_filepath, &src_file) != 0) {
+        return -1;
+    }
+    uint64_t src_hash = NU_Precompiled_Source_Hash(src_file.data, src_file.length);
+    uint32_t src_length = src_file.length;
+    File_Map_Close(&src_file);
+    return NU_Write_Precompiled(ui_tree, src_hash, src_length, src_mtime, bin_filepath);
+}
+
+// Loads the UI tree from the precompiled file if it was built from the current XML source (same size and
+// modification time, or else the same hash). Otherwise the source is parsed as usual and the precompiled file
+// is rewritten for the next launch. A loaded tree keeps the precompiled file mapped until it is freed.
+int NU_Load_Precompiled(char* src_filepath, char* bin_filepath, struct UI_Tree* ui_tree)
+{
+    uint64_t src_mtime, src_size;
+    if (NU_Precompiled_Source_Stamp(src_filepath, &src_mtime, &src_size) != 0) {
+        printf("[Precompiled] Error! Cannot find '%s'\n", src_filepath);
+        return -1;
+    }
+
+    // Up to date precompiled file -> no parsing (and no hashing unless the source's stamp changed)
+    struct File_Map src_file;
+    src_file.data = NULL;
+    uint64_t src_hash = 0;
+    struct File_Map bin_file;
+    bin_file.data = NULL;
+    FILE* probe = fopen(bin_filepath, "rb");
+    if (probe) {
+        fclose(probe);
+        File_Map_Open_Private(bin_filepath, &bin_file);
+    }
+    if (bin_file.data != NULL)
+    {
+        struct NU_Precompiled_Header header;
+        int up_to_date = 0;
+        if (bin_file.length >= sizeof(header))
+        {
+            memcpy(&header, bin_file.data, sizeof(header));
+            up_to_date = header.src_mtime == src_mtime && header.src_length == src_size;
+            if (!up_to_date && File_Map_Open(src_filepath, &src_file) == 0)
+            {
+                src_hash = NU_Precompiled_Source_Hash(src_file.data, src_file.length);
+                up_to_date = header.src_hash == src_hash && header.src_length == src_file.length;
+            }
+        }
+        if (up_to_date && NU_Read_Precompiled(&bin_file, ui_tree) == 0)
+        {
+            ui_tree->bin_file = bin_file;
+            File_Map_Close(&src_file);
+            return 0; // Success
+        }
+        File_Map_Close(&bin_file);
+    }
+
+    // Stale or missing -> parse the source and rewrite the precompiled file
+    if (src_file.data == NULL)
+    {
+        if (File_Map_Open(src_filepath, &src_file) != 0) {
+            return -1;
+        }
+        src_hash = NU_Precompiled_Source_Hash(src_file.data, src_file.length);
+    }
+    if (NU_Parse_Source(src_file.data, src_file.length, ui_tree) != 0)
+    {
+        File_Map_Close(&src_file);
+        return -1; // Failure
+    }
+    ui_tree->src_file = src_file;
+    NU_Write_Precompiled(ui_tree, src_hash, src_file.length, src_mtime, bin_filepath);
+    return 0; // Success
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Region allocator: blocks are bump allocated from a list of chunks and given back all at once, so whatever
+// owns a region (a UI_Tree) is torn down or reset with one call. The newest block can grow or be given back
+// in place, growing any other small block copies it and leaves the old copy in the region until it is reset.
+// Large blocks get a chunk of their own which is realloc'd as they grow (big layers grow without copies).
+#define REGION_ALIGN 16
+#define REGION_MIN_CHUNK 4096
+#define REGION_MAX_CHUNK (64u << 20) // chunks after the first double up to this size
+#define REGION_LARGE_BLOCK 32768
+
+struct Region_Chunk
+{
+    struct Region_Chunk* next;
+    size_t capacity;
+    size_t used;
+};
+
+#define REGION_CHUNK_HEADER ((sizeof(struct Region_Chunk) + REGION_ALIGN - 1) & ~(size_t) (REGION_ALIGN - 1))
+
+struct Region
+{
+    struct Region_Chunk* chunks; // newest first, blocks come from the newest chunk
+    struct Region_Chunk* large;  // one large block each
+    size_t next_chunk_size;
+    char* last;                  // newest block
+};
+
+static inline char* Region_Chunk_Data(struct Region_Chunk* chunk)
+{
+    return (char*) chunk + REGION_CHUNK_HEADER;
+}
+
+// The first chunk (initial_size bytes) is allocated on first use
+void Region_Init(struct Region* region, size_t initial_size)
+{
+    region->chunks = NULL;
+    region->large = NULL;
+    region->next_chunk_size = initial_size < REGION_MIN_CHUNK ? REGION_MIN_CHUNK : initial_size;
+    region->last = NULL;
+}
+
+static void* Region_Alloc_Large(struct Region* region, size_t size)
+{
+    struct Region_Chunk* chunk = malloc(REGION_CHUNK_HEADER + size);
+    chunk->next = region->large;
+    chunk->capacity = size;
+    chunk->used = size;
+    region->large = chunk;
+    return Region_Chunk_Data(chunk);
+}
+
+// Returns the link pointing at the large block's chunk or NULL if the block is not a large block
+static struct Region_Chunk** Region_Find_Large(struct Region* region, void* pointer)
+{
+    for (struct Region_Chunk** link = &region->large; *link != NULL; link = &(*link)->next) {
+        if (Region_Chunk_Data(*link) == pointer) return link;
+    }
+    return NULL;
+}
+
+void* Region_Alloc(struct Region* region, size_t size)
+{
+    if (size >= REGION_LARGE_BLOCK) return Region_Alloc_Large(region, size);
+    size = size == 0 ? REGION_ALIGN : (size + REGION_ALIGN - 1) & ~(size_t) (REGION_ALIGN - 1); // blocks never share an address
+    struct Region_Chunk* chunk = region->chunks;
+    if (chunk == NULL || chunk->used + size > chunk->capacity)
+    {
+        size_t capacity = region->next_chunk_size > size ? region->next_chunk_size : size;
+        chunk = malloc(REGION_CHUNK_HEADER + capacity);
+        chunk->next = region->chunks;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        region->chunks = chunk;
+        if (region->next_chunk_size < REGION_MAX_CHUNK) region->next_chunk_size *= 2;
+    }
+    region->last = Region_Chunk_Data(chunk) + chunk->used;
+    chunk->used += size;
+    return region->last;
+}
+
+void* Region_Realloc(struct Region* region, void* pointer, size_t old_size, size_t new_size)
+{
+    // Newest block with room behind it -> grow in place
+    struct Region_Chunk* chunk = region->chunks;
+    if (pointer != NULL && pointer == region->last)
+    {
+        size_t offset = (char*) pointer - Region_Chunk_Data(chunk);
+        size_t size = (new_size + REGION_ALIGN - 1) & ~(size_t) (REGION_ALIGN - 1);
+        if (offset + size <= chunk->capacity)
+        {
+            chunk->used = offset + size;
+            return pointer;
+        }
+    }
+
+    // Large block -> its chunk is realloc'd
+    struct Region_Chunk** link = old_size >= REGION_LARGE_BLOCK ? Region_Find_Large(region, pointer) : NULL;
+    if (link != NULL && new_size >= REGION_LARGE_BLOCK)
+    {
+        struct Region_Chunk* large = realloc(*link, REGION_CHUNK_HEADER + new_size);
+        large->capacity = new_size;
+        large->used = new_size;
+        *link = large;
+        return Region_Chunk_Data(large);
+    }
+    void* new_pointer = Region_Alloc(region, new_size);
+    if (old_size > 0) memcpy(new_pointer, pointer, old_size < new_size ? old_size : new_size);
+    if (link != NULL) // large block shrunk into a small one
+    {
+        struct Region_Chunk* large = *link;
+        *link = large->next;
+        free(large);
+    }
+    return new_pointer;
+}
+
+// Gives a block back (large blocks are freed, of the small blocks only the newest is reused before the region is reset)
+void Region_Release(struct Region* region, void* pointer)
+{
+    if (pointer == NULL) return;
+    if (pointer == region->last)
+    {
+        region->chunks->used = (char*) pointer - Region_Chunk_Data(region->chunks);
+        region->last = NULL;
+        return;
+    }
+    struct Region_Chunk** link = Region_Find_Large(region, pointer);
+    if (link == NULL) return;
+    struct Region_Chunk* large = *link;
+    *link = large->next;
+    free(large);
+}
+
+static void Region_Free_Chunks(struct Region_Chunk* chunk)
+{
+    while (chunk != NULL)
+    {
+        struct Region_Chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+// Frees every block but keeps the largest chunk for the next use
+void Region_Reset(struct Region* region)
+{
+    struct Region_Chunk* largest = NULL;
+    struct Region_Chunk* chunk = region->chunks;
+    while (chunk != NULL)
+    {
+        struct Region_Chunk* next = chunk->next;
+        if (largest == NULL || chunk->capacity > largest->capacity)
+        {
+            if (largest != NULL) free(largest);
+            largest = chunk;
+        }
+        else free(chunk);
+        chunk = next;
+    }
+    if (largest != NULL)
+    {
+        largest->next = NULL;
+        largest->used = 0;
+    }
+    region->chunks = largest;
+    region->last = NULL;
+    Region_Free_Chunks(region->large);
+    region->large = NULL;
+}
+
+void Region_Free(struct Region* region)
+{
+    Region_Free_Chunks(region->chunks);
+    Region_Free_Chunks(region->large);
+    region->chunks = NULL;
+    region->large = NULL;
+    region->last = NULL;
+}
+
+// Moves every chunk of src into dst (blocks keep their addresses, dst keeps allocating from its newest chunk)
+void Region_Adopt(struct Region* dst, struct Region* src)
+{
+    if (src->large != NULL)
+    {
+        struct Region_Chunk* tail = src->large;
+        while (tail->next != NULL) tail = tail->next;
+        tail->next = dst->large;
+        dst->large = src->large;
+        src->large = NULL;
+    }
+    if (src->chunks == NULL) return;
+    if (dst->chunks == NULL)
+    {
+        dst->chunks = src->chunks;
+        dst->last = src->last;
+    }
+    else
+    {
+        struct Region_Chunk* tail = src->chunks;
+        while (tail->next != NULL) tail = tail->next;
+        tail->next = dst->chunks->next;
+        dst->chunks->next = src->chunks;
+    }
+    src->chunks = NULL;
+    src->last = NULL;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Character classes the tokeniser jumps between
+#define SCAN_TEXT       0   // '<' '\t' '\n' '\r'                 -> end of a run of text content
+#define SCAN_TAG        1   // '>' '/' '=' '"' ' ' '\t' '\n' '\r' -> end of a word inside a tag
+#define SCAN_QUOTE      2   // '"'                                -> end of a property value
+#define SCAN_COMMENT    3   // '-'                                -> possible end of a comment
+#define SCAN_OPEN       4   // '<'                                -> start of a tag (structure only pre-scans)
+#define SCAN_CLOSE      5   // '>' '"'                            -> end of a tag or start of a value inside it
+
+// Set to 0 to force the scalar path (the tokeniser benchmark compares both)
+int Scan_SIMD_Enabled = 1;
+
+static const uint8_t Scan_Class_Table[256] = {
+    ['<']  = (1 << SCAN_TEXT) | (1 << SCAN_OPEN),
+    ['\t'] = (1 << SCAN_TEXT) | (1 << SCAN_TAG),
+    ['\n'] = (1 << SCAN_TEXT) | (1 << SCAN_TAG),
+    ['\r'] = (1 << SCAN_TEXT) | (1 << SCAN_TAG),
+    [' ']  = 1 << SCAN_TAG,
+    ['>']  = (1 << SCAN_TAG) | (1 << SCAN_CLOSE),
+    ['/']  = 1 << SCAN_TAG,
+    ['=']  = 1 << SCAN_TAG,
+    ['"']  = (1 << SCAN_TAG) | (1 << SCAN_QUOTE) | (1 << SCAN_CLOSE),
+    ['-']  = 1 << SCAN_COMMENT,
+};
+
+const char* Scan_Mode_Name()
+{
+    #if defined(__AVX2__)
+    return Scan_SIMD_Enabled ? "AVX2" : "scalar";
+    #elif defined(__SSE2__)
+    return Scan_SIMD_Enabled ? "SSE2" : "scalar";
+    #else
+    return "scalar";
+    #endif
+}
+
+#if defined(__SSE2__)
+// Bitmask of the bytes in a 16 byte block that belong to the scan class
+static inline uint32_t Scan_Mask_16(const char* block_ptr, int scan_class)
+{
+    __m128i block = _mm_loadu_si128((const __m128i*) block_ptr);
+    __m128i hits;
+    switch (scan_class)
+    {
+        case SCAN_TEXT:
+            hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('<')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+            break;
+        case SCAN_TAG:
+        {
+            __m128i structural = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('>')), _mm_cmpeq_epi8(block, _mm_set1_epi8('/'))),
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('=')), _mm_cmpeq_epi8(block, _mm_set1_epi8('"'))));
+            __m128i whitespace = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+            hits = _mm_or_si128(structural, whitespace);
+            break;
+        }
+        case SCAN_QUOTE:
+            hits = _mm_cmpeq_epi8(block, _mm_set1_epi8('"'));
+            break;
+        case SCAN_OPEN:
+            hits = _mm_cmpeq_epi8(block, _mm_set1_epi8('<'));
+            break;
+        case SCAN_CLOSE:
+            hits = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('>')), _mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+            break;
+        default:
+            hits = _mm_cmpeq_epi8(block, _mm_set1_epi8('-'));
+            break;
+    }
+    return (uint32_t) _mm_movemask_epi8(hits);
+}
+#endif
+
+#if defined(__AVX2__)
+// Bitmask of the bytes in a 32 byte block that belong to the scan class
+static inline uint32_t Scan_Mask_32(const char* block_ptr, int scan_class)
+{
+    __m256i block = _mm256_loadu_si256((const __m256i*) block_ptr);
+    __m256i hits;
+    switch (scan_class)
+    {
+        case SCAN_TEXT:
+            hits = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('<')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+            break;
+        case SCAN_TAG:
+        {
+            __m256i structural = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('>')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('=')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'))));
+            __m256i whitespace = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+            hits = _mm256_or_si256(structural, whitespace);
+            break;
+        }
+        case SCAN_QUOTE:
+            hits = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'));
+            break;
+        case SCAN_OPEN:
+            hits = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('<'));
+            break;
+        case SCAN_CLOSE:
+            hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('>')), _mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+            break;
+        default:
+            hits = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('-'));
+            break;
+    }
+    return (uint32_t) _mm256_movemask_epi8(hits);
+}
+#endif
+
+// Returns the index of the first character at or after i that belongs to the scan class (length if none)
+static inline uint32_t Scan_Until(const char* src, uint32_t i, uint32_t length, int scan_class)
+{
+    #if defined(__AVX2__)
+    if (Scan_SIMD_Enabled) {
+        while (i + 32 <= length) {
+            uint32_t mask = Scan_Mask_32(src + i, scan_class);
+            if (mask != 0) return i + __builtin_ctz(mask);
+            i += 32;
+        }
+    }
+    #endif
+
+    #if defined(__SSE2__)
+    if (Scan_SIMD_Enabled) {
+        while (i + 16 <= length) {
+            uint32_t mask = Scan_Mask_16(src + i, scan_class);
+            if (mask != 0) return i + __builtin_ctz(mask);
+            i += 16;
+        }
+    }
+    #endif
+
+    // Scalar fallback and block tail
+    const uint8_t class_bit = 1 << scan_class;
+    while (i < length && !(Scan_Class_Table[(uint8_t) src[i]] & class_bit)) i++;
+    return i;
+}
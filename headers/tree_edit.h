@@ -0,0 +1,618 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+
+// Tree editing: nodes are added and removed in place once the tree is built.
+// A parent's children live in a segment of the next layer, [first_child_index, first_child_index + child_capacity).
+// The first child_count slots hold the children and the rest is slack (dead slots, tag NAT), so adding a child
+// usually just fills the next slot. A full segment takes a free run of the layer or grows in place, shifting the
+// rest of the layer and fixing the first_child_index/parent_index values that pointed past it.
+// Node IDs are layer << 24 | index -> an edit renumbers the siblings after it and any nodes a growing segment shifts.
+// References that have to survive edits are handles (NU_Get_Node_Handle): a slot in a table that the moves keep
+// pointing at the node, plus a generation that tells a handle to a removed node apart.
+// The id table (NU_Get_Node_By_Id) maps ids to handles, so inserts and removals only add and drop their own ids.
+// Removing a window node does not close its SDL window (the window vectors own it, see NU_Close_Window).
+// Every edit marks the nodes it changes dirty, so the next NU_Render only lays out what the edit touched.
+// It also touches every layer it writes (NU_Touch_Layer), so tree snapshots only copy those layers.
+
+#define NU_MIN_CHILD_SLACK 4 // a segment grows by at least this many slots
+
+// Returns the live node with the ID or NULL
+static struct Node* NU_Edit_Get_Node(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    uint32_t layer = node_ID >> 24;
+    uint32_t index = node_ID & 0x00FFFFFF;
+    if (layer > ui_tree->deepest_layer || index >= ui_tree->tree_stack[layer].size) return NULL;
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[layer], index);
+    return node->tag == NAT ? NULL : node;
+}
+
+// Returns a handle to a live node (the node keeps its handle until it is removed). A node that doesn't exist
+// gets a handle that never resolves.
+struct Node_Handle NU_Get_Node_Handle(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    struct Node_Handle handle;
+    if (NU_Edit_Get_Node(ui_tree, node_ID) == NULL)
+    {
+        handle.index = UINT32_MAX;
+        handle.generation = 0;
+        return handle;
+    }
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    if (cold->handle_index == -1) NU_Touch_Layer(ui_tree, node_ID >> 24);
+    NU_Acquire_Handle_Slot(ui_tree, cold);
+    handle.index = cold->handle_index;
+    handle.generation = ((struct Node_Handle_Slot*) Vector_Get(&ui_tree->handles, handle.index))->generation;
+    return handle;
+}
+
+// Writes the node's current ID. Returns -1 if the node was removed.
+int NU_Resolve_Node_Handle(struct UI_Tree* ui_tree, struct Node_Handle handle, uint32_t* node_ID_out)
+{
+    if (handle.index >= ui_tree->handles.size) return -1;
+    struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, handle.index);
+    if (slot->generation != handle.generation) return -1;
+    *node_ID_out = slot->node_ID;
+    return 0; // Success
+}
+
+// Stales the node's handle and puts its slot on the free list
+static void NU_Release_Node_Handle(struct UI_Tree* ui_tree, struct Node_Cold* cold)
+{
+    struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, cold->handle_index);
+    slot->generation += 1;
+    slot->node_ID = ui_tree->free_handle;
+    ui_tree->free_handle = cold->handle_index;
+    cold->handle_index = -1;
+    ui_tree->id_generation += 1;
+}
+
+// Stales every handle and frees every slot (for when the layers are replaced wholesale)
+static void NU_Invalidate_Node_Handles(struct UI_Tree* ui_tree)
+{
+    uint32_t handle_count = ui_tree->handles.size;
+    for (uint32_t i=0; i<handle_count; i++)
+    {
+        struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, i);
+        slot->generation += 1;
+        slot->node_ID = (i + 1 < handle_count) ? i + 1 : UINT32_MAX;
+    }
+    ui_tree->free_handle = handle_count > 0 ? 0 : UINT32_MAX;
+    ui_tree->id_generation += 1;
+}
+
+// Turns a slot into a dead slot (slack of the parent at parent_index, or -1 for a free run)
+static void NU_Clear_Slot(struct UI_Tree* ui_tree, uint32_t layer, uint32_t index, int parent_index)
+{
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[layer], index);
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[layer], index);
+    NU_Init_Node(node, cold, NAT);
+    node->parent_index = parent_index;
+    cold->ID = (layer << 24) | index;
+    NU_Touch_Layer(ui_tree, layer);
+}
+
+// Moves slots within a layer and fixes everything that refers to them by index:
+// their IDs, text refs, handles and the parent_index of their children
+static void NU_Move_Slots(struct UI_Tree* ui_tree, uint32_t layer, uint32_t from, uint32_t to, uint32_t count)
+{
+    if (count == 0 || from == to) return;
+    NU_Touch_Layer(ui_tree, layer);
+    struct Vector* node_layer = &ui_tree->tree_stack[layer];
+    struct Vector* cold_layer = &ui_tree->cold_stack[layer];
+    memmove(Vector_Get(node_layer, to), Vector_Get(node_layer, from), count * sizeof(struct Node));
+    memmove(Vector_Get(cold_layer, to), Vector_Get(cold_layer, from), count * sizeof(struct Node_Cold));
+
+    for (uint32_t i=to; i<to+count; i++)
+    {
+        struct Node* node = Vector_Get(node_layer, i);
+        struct Node_Cold* cold = Vector_Get(cold_layer, i);
+        cold->ID = (layer << 24) | i;
+        if (cold->text_ref_index != -1) {
+            struct Text_Ref* text_ref = Vector_Get(&ui_tree->text_arena.text_refs, cold->text_ref_index);
+            text_ref->node_ID = cold->ID;
+            NU_Touch_Text(&ui_tree->text_arena, 0, 0);
+        }
+        if (cold->handle_index != -1) {
+            struct Node_Handle_Slot* slot = Vector_Get(&ui_tree->handles, cold->handle_index);
+            slot->node_ID = cold->ID;
+            ui_tree->id_generation += 1;
+        }
+        if (cold->child_capacity > 0) NU_Touch_Layer(ui_tree, layer+1);
+        for (int c=node->first_child_index; c<node->first_child_index + cold->child_capacity; c++) {
+            struct Node* child = Vector_Get(&ui_tree->tree_stack[layer+1], c);
+            child->parent_index = i;
+        }
+    }
+}
+
+// Takes length dead slots from the layer's free runs (first fit). Returns the first slot or -1.
+static int NU_Take_Free_Run(struct UI_Tree* ui_tree, uint32_t layer, uint32_t length)
+{
+    NU_Touch_Layer(ui_tree, layer);
+    struct Vector* free_slots = &ui_tree->free_slots[layer];
+    for (uint32_t i=0; i<free_slots->size; i++)
+    {
+        struct Layer_Free_Run* run = Vector_Get(free_slots, i);
+        if (run->length < length) continue;
+        uint32_t index = run->index;
+        run->index += length;
+        run->length -= length;
+        if (run->length == 0) {
+            *run = *(struct Layer_Free_Run*) Vector_Get(free_slots, free_slots->size - 1);
+            free_slots->size -= 1;
+        }
+        return (int) index;
+    }
+    return -1;
+}
+
+// Hands a segment no parent owns any more to the layer's free runs (a segment at the end of the layer shortens it)
+static void NU_Release_Run(struct UI_Tree* ui_tree, uint32_t layer, uint32_t index, uint32_t length)
+{
+    NU_Touch_Layer(ui_tree, layer);
+    if (index + length == ui_tree->tree_stack[layer].size)
+    {
+        ui_tree->tree_stack[layer].size -= length;
+        ui_tree->cold_stack[layer].size -= length;
+        return;
+    }
+    for (uint32_t i=index; i<index+length; i++) {
+        NU_Clear_Slot(ui_tree, layer, i, -1);
+    }
+    struct Layer_Free_Run run;
+    run.index = index;
+    run.length = length;
+    Vector_Push(&ui_tree->free_slots[layer], &run);
+}
+
+// Removes a text ref (the last ref takes its place so the refs stay packed), its chars go back to the arena
+static void NU_Remove_Text_Ref(struct UI_Tree* ui_tree, int text_ref_index)
+{
+    struct Text_Arena* text_arena = &ui_tree->text_arena;
+    struct Text_Ref* text_ref = Vector_Get(&text_arena->text_refs, text_ref_index);
+    NU_Touch_Text(text_arena, 0, 0);
+    if (!text_ref->in_source) NU_Text_Arena_Free(text_arena, text_ref->buffer_index, text_ref->char_capacity + 1);
+    text_arena->free_rows += text_ref->row_capacity;
+
+    uint32_t last = text_arena->text_refs.size - 1;
+    if ((uint32_t) text_ref_index != last)
+    {
+        *text_ref = *(struct Text_Ref*) Vector_Get(&text_arena->text_refs, last);
+        struct Node_Cold* owner = Vector_Get(&ui_tree->cold_stack[text_ref->node_ID >> 24], text_ref->node_ID & 0x00FFFFFF);
+        owner->text_ref_index = text_ref_index;
+        NU_Touch_Layer(ui_tree, text_ref->node_ID >> 24);
+    }
+    text_arena->text_refs.size -= 1;
+}
+
+// Releases a node's text, id and handle and, depth first, everything below it (child segments go to the free runs)
+static void NU_Release_Subtree(struct UI_Tree* ui_tree, uint32_t layer, uint32_t index)
+{
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[layer], index);
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[layer], index);
+    NU_Touch_Layer(ui_tree, layer);
+    if (cold->text_ref_index != -1) {
+        NU_Remove_Text_Ref(ui_tree, cold->text_ref_index);
+        cold->text_ref_index = -1;
+    }
+    NU_Id_Table_Remove(ui_tree, cold);
+    if (cold->handle_index != -1) {
+        NU_Release_Node_Handle(ui_tree, cold);
+    }
+    if (cold->child_capacity == 0) return;
+
+    for (int i=node->first_child_index; i<node->first_child_index + node->child_count; i++) {
+        NU_Release_Subtree(ui_tree, layer+1, i);
+    }
+    NU_Release_Run(ui_tree, layer+1, node->first_child_index, cold->child_capacity);
+}
+
+// Gives a parent whose segment is full more slack (room for at least min_capacity children)
+static int NU_Grow_Child_Segment(struct UI_Tree* ui_tree, uint32_t layer, uint32_t parent_index, uint32_t min_capacity)
+{
+    struct Node* parent = Vector_Get(&ui_tree->tree_stack[layer], parent_index);
+    struct Node_Cold* parent_cold = Vector_Get(&ui_tree->cold_stack[layer], parent_index);
+    uint32_t capacity = parent_cold->child_capacity;
+    if (min_capacity > UINT16_MAX)
+    {
+        printf("%s %d %s\n", "[Tree_Edit] Error! A node can't have more than", UINT16_MAX, "children");
+        return -1; // Failure
+    }
+    uint32_t new_capacity = MIN(MAX(MAX(capacity * 2, NU_MIN_CHILD_SLACK), min_capacity), UINT16_MAX);
+    uint32_t extra = new_capacity - capacity;
+    NU_Touch_Layer(ui_tree, layer);
+    NU_Touch_Layer(ui_tree, layer+1);
+    struct Vector* child_layer = &ui_tree->tree_stack[layer+1];
+    struct Vector* child_cold_layer = &ui_tree->cold_stack[layer+1];
+    struct Vector* free_slots = &ui_tree->free_slots[layer+1];
+
+    if (capacity == 0)
+    {
+        // No segment yet -> a free run, otherwise the end of the layer
+        int index = NU_Take_Free_Run(ui_tree, layer+1, new_capacity);
+        if (index == -1)
+        {
+            index = child_layer->size;
+            Vector_Resize(child_layer, index + new_capacity);
+            Vector_Resize(child_cold_layer, index + new_capacity);
+        }
+        parent->first_child_index = index;
+    }
+    else
+    {
+        uint32_t end = parent->first_child_index + capacity;
+        int absorbed = 0;
+        for (uint32_t r=0; r<free_slots->size && !absorbed; r++)
+        {
+            // Free run right behind the segment -> take the front of it
+            struct Layer_Free_Run* run = Vector_Get(free_slots, r);
+            if (run->index != end || run->length < extra) continue;
+            run->index += extra;
+            run->length -= extra;
+            if (run->length == 0) {
+                *run = *(struct Layer_Free_Run*) Vector_Get(free_slots, free_slots->size - 1);
+                free_slots->size -= 1;
+            }
+            absorbed = 1;
+        }
+
+        if (!absorbed)
+        {
+            uint32_t layer_size = child_layer->size;
+            Vector_Resize(child_layer, layer_size + extra);
+            Vector_Resize(child_cold_layer, layer_size + extra);
+
+            // Segment in the middle of the layer -> shift the rest of the layer up
+            if (end < layer_size)
+            {
+                NU_Move_Slots(ui_tree, layer+1, end, end + extra, layer_size - end);
+                struct Vector* parent_layer = &ui_tree->tree_stack[layer];
+                for (uint32_t p=0; p<parent_layer->size; p++)
+                {
+                    struct Node* node = Vector_Get(parent_layer, p);
+                    if (node->first_child_index >= (int) end) node->first_child_index += extra;
+                }
+                for (uint32_t r=0; r<free_slots->size; r++)
+                {
+                    struct Layer_Free_Run* run = Vector_Get(free_slots, r);
+                    if (run->index >= end) run->index += extra;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i=parent->first_child_index + capacity; i<parent->first_child_index + new_capacity; i++) {
+        NU_Clear_Slot(ui_tree, layer+1, i, parent_index);
+    }
+    parent_cold->child_capacity = new_capacity;
+    return 0; // Success
+}
+
+// Inserts a node with default properties as the position-th child of the parent (position >= child_count appends).
+// The new node's ID is written to node_ID_out.
+int NU_Insert_Node(struct UI_Tree* ui_tree, uint32_t parent_ID, uint32_t position, enum Tag tag, uint32_t* node_ID_out)
+{
+    struct Node* parent = NU_Edit_Get_Node(ui_tree, parent_ID);
+    if (parent == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Parent node", parent_ID, "does not exist");
+        return -1; // Failure
+    }
+    uint32_t layer = parent_ID >> 24;
+    uint32_t parent_index = parent_ID & 0x00FFFFFF;
+    if (layer+1 == MAX_TREE_DEPTH)
+    {
+        printf("%s %d\n", "[Tree_Edit] Error! Exceeded max tree depth of", MAX_TREE_DEPTH);
+        return -1; // Failure
+    }
+    NU_Reserve_Layers(ui_tree, layer + 3);
+
+    struct Node_Cold* parent_cold = Vector_Get(&ui_tree->cold_stack[layer], parent_index);
+    if (parent->child_count == parent_cold->child_capacity && NU_Grow_Child_Segment(ui_tree, layer, parent_index, parent->child_count + 1) != 0) {
+        return -1; // Failure
+    }
+
+    // Later siblings move up into the slack
+    position = MIN(position, parent->child_count);
+    uint32_t index = parent->first_child_index + position;
+    NU_Move_Slots(ui_tree, layer+1, index, index + 1, parent->child_count - position);
+
+    struct Node* node = Vector_Get(&ui_tree->tree_stack[layer+1], index);
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[layer+1], index);
+    NU_Init_Node(node, cold, tag);
+    node->parent_index = parent_index;
+    cold->ID = ((layer+1) << 24) | index;
+    NU_Touch_Layer(ui_tree, layer+1);
+    parent->child_count += 1;
+    ui_tree->deepest_layer = MAX(ui_tree->deepest_layer, layer+1);
+    NU_Mark_Node_Dirty(ui_tree, parent_ID);
+    *node_ID_out = cold->ID;
+    return 0; // Success
+}
+
+// Gives a node an id that NU_Get_Node_By_Id finds (replacing any id it had)
+int NU_Set_Node_Id(struct UI_Tree* ui_tree, uint32_t node_ID, const char* id)
+{
+    if (NU_Edit_Get_Node(ui_tree, node_ID) == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Node", node_ID, "does not exist");
+        return -1; // Failure
+    }
+    if (id[0] == '\0')
+    {
+        printf("%s\n", "[Tree_Edit] Error! An id can't be empty");
+        return -1; // Failure
+    }
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    NU_Assign_Node_Id(ui_tree, cold, id, strlen(id));
+    NU_Touch_Layer(ui_tree, node_ID >> 24);
+    return 0; // Success
+}
+
+// Sets a node's text (the node gets a text ref if it has none). Text that fits the node's block is overwritten
+// in place, otherwise it moves to a best fit free block of the arena. The text buffer can be freed afterwards.
+int NU_Set_Text(struct UI_Tree* ui_tree, uint32_t node_ID, const char* text, uint32_t length)
+{
+    if (NU_Edit_Get_Node(ui_tree, node_ID) == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Node", node_ID, "does not exist");
+        return -1; // Failure
+    }
+    struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[node_ID >> 24], node_ID & 0x00FFFFFF);
+    struct Vector* text_refs = &ui_tree->text_arena.text_refs;
+    if (cold->text_ref_index == -1)
+    {
+        struct Text_Ref new_ref = {0}; // no chars or rows yet
+        new_ref.node_ID = node_ID;
+        new_ref.in_source = 1; // no block to free yet
+        new_ref.measured_font = -1;
+        new_ref.break_width = -1.0f;
+        cold->text_ref_index = text_refs->size;
+        Vector_Push(text_refs, &new_ref);
+    }
+    NU_Write_Text(&ui_tree->text_arena, Vector_Get(text_refs, cold->text_ref_index), text, length);
+    NU_Mark_Node_Dirty(ui_tree, node_ID);
+    return 0; // Success
+}
+
+// Copies count children of src_parent_ID in src_tree (from child src_first on), and everything below them, into the
+// parent's children at position (position >= child_count appends). src_tree must be a parsed tree (the copied nodes
+// fill one block of each of its layers) and is left as it was. Each block is copied into the tree in one go (the top
+// level into the parent's segment, deeper layers into a free run or the end of their layer), then its indices, IDs,
+// text and ids are fixed up in a single pass.
+int NU_Insert_Tree_Children(struct UI_Tree* ui_tree, uint32_t parent_ID, uint32_t position, struct UI_Tree* src_tree, uint32_t src_parent_ID, uint32_t src_first, uint32_t count)
+{
+    struct Node* parent = NU_Edit_Get_Node(ui_tree, parent_ID);
+    if (parent == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Parent node", parent_ID, "does not exist");
+        return -1; // Failure
+    }
+    uint32_t layer = parent_ID >> 24;
+    uint32_t parent_index = parent_ID & 0x00FFFFFF;
+    struct Node_Cold* parent_cold = Vector_Get(&ui_tree->cold_stack[layer], parent_index);
+    uint32_t src_layer = src_parent_ID >> 24;
+    struct Node* src_parent = Vector_Get(&src_tree->tree_stack[src_layer], src_parent_ID & 0x00FFFFFF);
+    uint32_t top_count = (src_first < src_parent->child_count) ? MIN(count, src_parent->child_count - src_first) : 0;
+    if (top_count == 0) return 0;
+
+    // The block each src layer below the parent copies from (k == 1 -> the children)
+    uint32_t block_starts[MAX_TREE_DEPTH + 2];
+    uint32_t block_sizes[MAX_TREE_DEPTH + 2];
+    uint32_t depth = 1;
+    block_starts[1] = src_parent->first_child_index + src_first;
+    block_sizes[1] = top_count;
+    while (src_layer + depth < MAX_TREE_DEPTH)
+    {
+        struct Node* nodes = Vector_Get(&src_tree->tree_stack[src_layer+depth], block_starts[depth]);
+        int first = -1;
+        uint32_t end = 0;
+        for (uint32_t i=0; i<block_sizes[depth]; i++)
+        {
+            if (nodes[i].child_count == 0) continue;
+            if (first == -1) first = nodes[i].first_child_index;
+            end = nodes[i].first_child_index + nodes[i].child_count;
+        }
+        if (first == -1) break;
+        depth++;
+        block_starts[depth] = first;
+        block_sizes[depth] = end - first;
+    }
+    if (layer + depth >= MAX_TREE_DEPTH)
+    {
+        printf("%s %d\n", "[Tree_Edit] Error! Exceeded max tree depth of", MAX_TREE_DEPTH);
+        return -1; // Failure
+    }
+    NU_Reserve_Layers(ui_tree, layer + depth + 2);
+    if (parent->child_count + top_count > parent_cold->child_capacity && NU_Grow_Child_Segment(ui_tree, layer, parent_index, parent->child_count + top_count) != 0) {
+        return -1; // Failure
+    }
+
+    // Later siblings move up into the slack
+    position = MIN(position, parent->child_count);
+    uint32_t index = parent->first_child_index + position;
+    NU_Move_Slots(ui_tree, layer+1, index, index + top_count, parent->child_count - position);
+
+    // Where each block lands
+    uint32_t layer_offsets[MAX_TREE_DEPTH + 2];
+    layer_offsets[1] = index;
+    for (uint32_t k=2; k<=depth; k++)
+    {
+        int block_index = NU_Take_Free_Run(ui_tree, layer+k, block_sizes[k]);
+        if (block_index == -1)
+        {
+            block_index = ui_tree->tree_stack[layer+k].size;
+            Vector_Resize(&ui_tree->tree_stack[layer+k], block_index + block_sizes[k]);
+            Vector_Resize(&ui_tree->cold_stack[layer+k], block_index + block_sizes[k]);
+        }
+        layer_offsets[k] = block_index;
+    }
+    block_starts[depth+1] = 0;
+    layer_offsets[depth+1] = 0;
+    parent->child_count += top_count;
+    ui_tree->deepest_layer = MAX(ui_tree->deepest_layer, layer + depth);
+
+    // Copy each block and fix it up (a layer's parents are in place before its text marks them dirty)
+    for (uint32_t k=1; k<=depth; k++)
+    {
+        struct Node* nodes = Vector_Get(&ui_tree->tree_stack[layer+k], layer_offsets[k]);
+        struct Node_Cold* colds = Vector_Get(&ui_tree->cold_stack[layer+k], layer_offsets[k]);
+        memcpy(nodes, Vector_Get(&src_tree->tree_stack[src_layer+k], block_starts[k]), block_sizes[k] * sizeof(struct Node));
+        memcpy(colds, Vector_Get(&src_tree->cold_stack[src_layer+k], block_starts[k]), block_sizes[k] * sizeof(struct Node_Cold));
+        NU_Touch_Layer(ui_tree, layer+k);
+        for (uint32_t i=0; i<block_sizes[k]; i++)
+        {
+            nodes[i].parent_index = (k == 1) ? (int) parent_index : nodes[i].parent_index - (int) block_starts[k-1] + (int) layer_offsets[k-1];
+            if (nodes[i].child_count > 0) nodes[i].first_child_index += (int) layer_offsets[k+1] - (int) block_starts[k+1];
+            colds[i].ID = ((layer+k) << 24) | (layer_offsets[k] + i);
+            colds[i].handle_index = -1;
+            if (colds[i].id_index != -1)
+            {
+                const char* id = (char*) src_tree->id_chars.data + colds[i].id_index;
+                colds[i].id_index = -1;
+                NU_Assign_Node_Id(ui_tree, &colds[i], id, strlen(id));
+            }
+            if (colds[i].text_ref_index != -1)
+            {
+                struct Text_Ref* src_ref = Vector_Get(&src_tree->text_arena.text_refs, colds[i].text_ref_index);
+                colds[i].text_ref_index = -1;
+                NU_Set_Text(ui_tree, colds[i].ID, NU_Text_Ref_Chars(src_tree, src_ref), src_ref->char_count);
+            }
+        }
+    }
+    NU_Mark_Node_Dirty(ui_tree, parent_ID);
+    return 0; // Success
+}
+
+// Parses an XML fragment (any number of sibling elements) into private layers and appends it to the parent's
+// children (see NU_Insert_Tree_Children). The xml buffer can be freed afterwards.
+int NU_Insert_Fragment(struct UI_Tree* ui_tree, uint32_t parent_ID, const char* xml, uint32_t length)
+{
+    if (NU_Edit_Get_Node(ui_tree, parent_ID) == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Parent node", parent_ID, "does not exist");
+        return -1; // Failure
+    }
+
+    // Stand in root -> the fragment's top level elements land in layer 1 of the fragment tree
+    struct UI_Tree fragment_tree;
+    struct NU_Parser parser;
+    NU_Parser_Init(&parser, &fragment_tree, length);
+    NU_Parser_Open_Node(&parser, WINDOW);
+    parser.grammar = GRAMMAR_CONTENT;
+    uint32_t consumed;
+    int result = NU_Tokenise((char*) xml, length, &parser, 1, &consumed);
+    Vector_Free(&parser.carry);
+    struct Node_Cold* fragment_root_cold = Vector_Get(&fragment_tree.cold_stack[0], 0);
+    if (result == 0 && (parser.current_layer != 0 || parser.ctx != 0 || parser.text_char_count > 0 || fragment_root_cold->text_ref_index != -1))
+    {
+        printf("%s\n", "[Tree_Edit] Error! An XML fragment must be a list of complete elements");
+        result = -1;
+    }
+    struct Node* fragment_root = Vector_Get(&fragment_tree.tree_stack[0], 0);
+    if (result == 0) result = NU_Insert_Tree_Children(ui_tree, parent_ID, UINT32_MAX, &fragment_tree, 0, 0, fragment_root->child_count);
+    NU_Free_UI_Tree_Memory(&fragment_tree);
+    return result;
+}
+
+// Removes count children of the parent starting at child first, and everything below them.
+// The later siblings move down in one go and the parent keeps the freed slots as slack.
+int NU_Remove_Children(struct UI_Tree* ui_tree, uint32_t parent_ID, uint32_t first, uint32_t count)
+{
+    struct Node* parent = NU_Edit_Get_Node(ui_tree, parent_ID);
+    if (parent == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Parent node", parent_ID, "does not exist");
+        return -1; // Failure
+    }
+    uint32_t layer = parent_ID >> 24;
+    uint32_t parent_index = parent_ID & 0x00FFFFFF;
+    if (first >= parent->child_count) return 0;
+    count = MIN(count, parent->child_count - first);
+
+    uint32_t start = parent->first_child_index + first;
+    for (uint32_t i=start; i<start+count; i++) {
+        NU_Release_Subtree(ui_tree, layer+1, i);
+    }
+    uint32_t end = parent->first_child_index + parent->child_count;
+    NU_Move_Slots(ui_tree, layer+1, start + count, start, end - start - count);
+    for (uint32_t i=end-count; i<end; i++) {
+        NU_Clear_Slot(ui_tree, layer+1, i, parent_index);
+    }
+    parent->child_count -= count;
+    NU_Mark_Node_Dirty(ui_tree, parent_ID);
+    return 0; // Success
+}
+
+// Removes a node and everything below it
+int NU_Remove_Subtree(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    struct Node* node = NU_Edit_Get_Node(ui_tree, node_ID);
+    if (node == NULL)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Node", node_ID, "does not exist");
+        return -1; // Failure
+    }
+    uint32_t layer = node_ID >> 24;
+    uint32_t index = node_ID & 0x00FFFFFF;
+    if (layer == 0)
+    {
+        printf("%s\n", "[Tree_Edit] Error! The root window can't be removed");
+        return -1; // Failure
+    }
+    struct Node* parent = Vector_Get(&ui_tree->tree_stack[layer-1], node->parent_index);
+    uint32_t parent_ID = ((layer-1) << 24) | node->parent_index;
+    return NU_Remove_Children(ui_tree, parent_ID, index - parent->first_child_index, 1);
+}
+
+// Removes a node without children (use NU_Remove_Subtree for the rest)
+int NU_Remove_Node(struct UI_Tree* ui_tree, uint32_t node_ID)
+{
+    struct Node* node = NU_Edit_Get_Node(ui_tree, node_ID);
+    if (node != NULL && node->child_count > 0)
+    {
+        printf("%s %u %s\n", "[Tree_Edit] Error! Node", node_ID, "has children, use NU_Remove_Subtree");
+        return -1; // Failure
+    }
+    return NU_Remove_Subtree(ui_tree, node_ID);
+}
+
+// Fills old_windows (reserved here) with the cold data of every window node that has an SDL window, in layer order.
+// Trees that replace their layers hand these to their window nodes in order.
+static void NU_Collect_Windows(struct UI_Tree* ui_tree, struct Vector* old_windows)
+{
+    Vector_Reserve(old_windows, sizeof(struct Node_Cold), 4);
+    for (int l=0; l<=ui_tree->deepest_layer; l++)
+    {
+        struct Vector* layer = &ui_tree->tree_stack[l];
+        for (uint32_t n=0; n<layer->size; n++) {
+            struct Node* node = Vector_Get(layer, n);
+            struct Node_Cold* cold = Vector_Get(&ui_tree->cold_stack[l], n);
+            if (node->tag == WINDOW && cold->window != NULL) Vector_Push(old_windows, cold);
+        }
+    }
+}
+
+// Destroys a window that no node uses any more, with its GL context, nanovg context and font registry
+static void NU_Close_Window(struct UI_Tree* ui_tree, SDL_Window* window, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    for (uint32_t i=0; i<windows->size; i++)
+    {
+        if (*(SDL_Window**) Vector_Get(windows, i) != window) continue;
+        SDL_GLContext gl_context = *(SDL_GLContext*) Vector_Get(gl_contexts, i);
+        SDL_GL_MakeCurrent(window, gl_context);
+        nvgDeleteGL3(*(NVGcontext**) Vector_Get(nano_vg_contexts, i));
+        SDL_GL_DestroyContext(gl_context);
+        SDL_DestroyWindow(window);
+        Vector_Free((struct Vector*) Vector_Get(&ui_tree->font_registries, i));
+        Vector_Remove(windows, i);
+        Vector_Remove(gl_contexts, i);
+        Vector_Remove(nano_vg_contexts, i);
+        Vector_Remove(&ui_tree->font_registries, i);
+        return;
+    }
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "parser.h"
+#include "tree_edit.h"
+
+// Tree snapshots: a producer thread edits its own copy of the tree while the render thread lays out and draws
+// another, so UI updates never wait for NU_Render (and NU_Render never waits for them).
+//   back    -> only touched by the producer (NU_Snapshots_Back, then any tree_edit.h call)
+//   pending -> the last published back tree, NU_Snapshots_Publish copies the back tree into it
+//   front   -> only touched by the render thread, NU_Snapshots_Swap exchanges it with a newly published tree
+// Neither thread ever copies from a tree the other one is writing. Every edit bumps the generation of what it
+// writes (a layer, the text arena and its char blocks, the handles and ids), so a publish only copies what
+// changed since the pending tree last got a copy. The swap hands the windows over and keeps the old front
+// tree's layout results wherever the nodes still match, so NU_Render only lays out what the edits changed.
+// Handles and ids resolve the same way in every snapshot (they are copied with the nodes).
+struct NU_Tree_Snapshots
+{
+    struct UI_Tree trees[2];
+    struct UI_Tree* front;
+    struct UI_Tree* back;
+    struct UI_Tree* pending;
+    SDL_Mutex* mutex; // guards pending and pending_ready
+    uint8_t pending_ready;
+};
+
+// Copies the nodes, text, handles and ids of src into dst's own memory. With changed_only dst holds an older
+// copy of src and only the layers, char blocks, text refs and ids whose generation moved since are copied.
+// Windows and nanovg contexts are set on the swap. src must have no text in its source file (see
+// NU_Detach_Source_Text).
+static void NU_Copy_UI_Tree(struct UI_Tree* dst, struct UI_Tree* src, uint8_t changed_only)
+{
+    NU_Reserve_Layers(dst, src->deepest_layer + 2);
+    for (uint32_t l=0; l<dst->layer_count; l++)
+    {
+        uint32_t generation = (l < src->layer_count) ? src->layer_generations[l] : 0;
+        if (l > (uint32_t) src->deepest_layer)
+        {
+            dst->tree_stack[l].size = 0;
+            dst->cold_stack[l].size = 0;
+            dst->free_slots[l].size = 0;
+        }
+        else if (!changed_only || dst->layer_generations[l] != generation)
+        {
+            Vector_Copy(&dst->tree_stack[l], &src->tree_stack[l]);
+            Vector_Copy(&dst->cold_stack[l], &src->cold_stack[l]);
+            Vector_Copy(&dst->free_slots[l], &src->free_slots[l]);
+        }
+        dst->layer_generations[l] = generation;
+    }
+    dst->deepest_layer = src->deepest_layer;
+
+    struct Text_Arena* text_arena = &dst->text_arena;
+    struct Text_Arena* src_arena = &src->text_arena;
+    if (!changed_only || text_arena->generation != src_arena->generation)
+    {
+        for (int c=0; c<NU_TEXT_SIZE_CLASSES; c++) {
+            Vector_Copy(&text_arena->free_lists[c], &src_arena->free_lists[c]);
+        }
+        text_arena->free_chars = src_arena->free_chars;
+        Vector_Copy(&text_arena->text_refs, &src_arena->text_refs);
+        Vector_Copy(&text_arena->rows, &src_arena->rows);
+        text_arena->free_rows = src_arena->free_rows;
+
+        // Chars in blocks (a block without a generation on either side or past dst's old end is always copied)
+        uint32_t old_size = text_arena->char_buffer.size;
+        uint32_t char_count = src_arena->char_buffer.size;
+        Vector_Resize(&text_arena->char_buffer, char_count);
+        uint32_t* block_generations = text_arena->block_generations.data;
+        uint32_t* src_block_generations = src_arena->block_generations.data;
+        for (uint32_t b=0; b * NU_TEXT_COPY_BLOCK < char_count; b++)
+        {
+            uint32_t start = b * NU_TEXT_COPY_BLOCK;
+            uint32_t end = MIN(start + NU_TEXT_COPY_BLOCK, char_count);
+            if (changed_only && end <= old_size && b < text_arena->block_generations.size && b < src_arena->block_generations.size &&
+                block_generations[b] == src_block_generations[b]) continue;
+            memcpy((char*) text_arena->char_buffer.data + start, (char*) src_arena->char_buffer.data + start, end - start);
+        }
+        Vector_Copy(&text_arena->block_generations, &src_arena->block_generations);
+        text_arena->generation = src_arena->generation;
+    }
+
+    if (!changed_only || dst->id_generation != src->id_generation)
+    {
+        Vector_Copy(&dst->handles, &src->handles);
+        dst->free_handle = src->free_handle;
+        Vector_Copy(&dst->id_chars, &src->id_chars);
+        Vector_Copy(&dst->id_table, &src->id_table);
+        dst->id_count = src->id_count;
+        dst->id_generation = src->id_generation;
+    }
+}
+
+// 1 if a node of the new front tree lays out like the old front tree's node at the same index: the same
+// properties, parent, child list and text
+static int NU_Same_Layout_Inputs(struct UI_Tree* tree, struct Node* a, struct Node_Cold* a_cold, struct UI_Tree* old_tree, struct Node* b, struct Node_Cold* b_cold)
+{
+    int same = a->tag == b->tag && a->parent_index == b->parent_index && a->child_count == b->child_count &&
+               (a->child_count == 0 || a->first_child_index == b->first_child_index) &&
+               a->preferred_width == b->preferred_width && a->preferred_height == b->preferred_height &&
+               (a_cold->text_ref_index == -1 ? a->min_width == b->min_width : a->min_width <= b->min_width) && // layout raises a text node's min width to its longest word
+               a->max_width == b->max_width &&
+               a->min_height == b->min_height && a->max_height == b->max_height &&
+               a->gap == b->gap &&
+               a->pad_top == b->pad_top && a->pad_bottom == b->pad_bottom && a->pad_left == b->pad_left && a->pad_right == b->pad_right &&
+               a->border_top == b->border_top && a->border_bottom == b->border_bottom && a->border_left == b->border_left && a->border_right == b->border_right &&
+               a->layout_flags == b->layout_flags &&
+               a->width_unit == b->width_unit && a->height_unit == b->height_unit &&
+               a->horizontal_alignment == b->horizontal_alignment &&
+               a->vertical_alignment == b->vertical_alignment &&
+               (a_cold->text_ref_index == -1) == (b_cold->text_ref_index == -1);
+    if (!same || a_cold->text_ref_index == -1) return same;
+    struct Text_Ref* a_ref = Vector_Get(&tree->text_arena.text_refs, a_cold->text_ref_index);
+    struct Text_Ref* b_ref = Vector_Get(&old_tree->text_arena.text_refs, b_cold->text_ref_index);
+    return a_ref->char_count == b_ref->char_count && memcmp(NU_Text_Ref_Chars(tree, a_ref), NU_Text_Ref_Chars(old_tree, b_ref), a_ref->char_count) == 0;
+}
+
+// Gives the nodes of the new front tree the layout results (and pending dirty bits) of the nodes they match in
+// the old front tree: every node of a layer with the old front's generation, otherwise the node at the same index
+// if its layout inputs are the same. The other nodes are marked dirty, so the next NU_Render lays out only them
+// and what they change (as if the edits had been made to the old front tree).
+static void NU_Keep_Layout_Results(struct UI_Tree* front, struct UI_Tree* old_front)
+{
+    for (int l=0; l<=front->deepest_layer; l++)
+    {
+        struct Vector* layer = &front->tree_stack[l];
+        struct Vector* old_layer = &old_front->tree_stack[l];
+        uint32_t old_size = (l <= old_front->deepest_layer) ? old_layer->size : 0;
+        int unchanged = old_size == layer->size && front->layer_generations[l] == old_front->layer_generations[l];
+        for (uint32_t n=0; n<layer->size; n++)
+        {
+            struct Node* node = Vector_Get(layer, n);
+            node->dirty = 0;
+            if (node->tag == NAT) continue;
+            struct Node* old_node = (n < old_size) ? Vector_Get(old_layer, n) : NULL;
+            struct Node_Cold* cold = Vector_Get(&front->cold_stack[l], n);
+            struct Node_Cold* old_cold = (n < old_size) ? Vector_Get(&old_front->cold_stack[l], n) : NULL;
+            if (old_node != NULL && (unchanged || NU_Same_Layout_Inputs(front, node, cold, old_front, old_node, old_cold)))
+            {
+                node->x = old_node->x;
+                node->y = old_node->y;
+                node->width = old_node->width;
+                node->height = old_node->height;
+                node->fit_width = old_node->fit_width;
+                node->fit_height = old_node->fit_height;
+                node->min_width = old_node->min_width;
+                node->dirty = old_node->dirty & NU_DIRTY_ALL;
+                if (old_node->dirty & NU_DIRTY_SELF) NU_Mark_Dirty_Path(front, ((uint32_t) l << 24) | n); // not laid out since
+
+                // The same text keeps its measurement (its rows are broken again when drawn)
+                if (cold->text_ref_index == -1) continue;
+                struct Text_Ref* text_ref = Vector_Get(&front->text_arena.text_refs, cold->text_ref_index);
+                struct Text_Ref* old_ref = Vector_Get(&old_front->text_arena.text_refs, old_cold->text_ref_index);
+                if (text_ref->measured_font != -1 || old_ref->measured_font == -1) continue;
+                text_ref->measured_font = old_ref->measured_font;
+                text_ref->measured_size = old_ref->measured_size;
+                text_ref->text_width = old_ref->text_width;
+                text_ref->word_width = old_ref->word_width;
+                text_ref->line_height = old_ref->line_height;
+                text_ref->break_width = -1.0f;
+            }
+            else NU_Mark_Dirty_Path(front, ((uint32_t) l << 24) | n); // the layers above are done, their marks stay
+        }
+    }
+}
+
+// Takes over a parsed tree as the first front tree and makes the back and pending copies of it.
+// The tree struct must outlive the snapshots, NU_Snapshots_Close frees its memory with the copies.
+int NU_Snapshots_Init(struct NU_Tree_Snapshots* snapshots, struct UI_Tree* ui_tree)
+{
+    snapshots->mutex = SDL_CreateMutex();
+    if (snapshots->mutex == NULL)
+    {
+        printf("%s %s\n", "[Snapshots] Error! Could not create the mutex:", SDL_GetError());
+        return -1; // Failure
+    }
+
+    // All three trees hold the same chars (no text left in the source file) with a generation for every block
+    NU_Detach_Source_Text(ui_tree);
+    NU_Touch_Text(&ui_tree->text_arena, 0, ui_tree->text_arena.char_buffer.size);
+    for (int i=0; i<2; i++)
+    {
+        struct UI_Tree* copy = &snapshots->trees[i];
+        NU_Init_UI_Tree_Memory(copy, 0);
+        NU_Copy_UI_Tree(copy, ui_tree, 0);
+        memset(&copy->font_resources, 0, sizeof(struct Vector)); // the fonts stay with the front tree
+        memset(&copy->font_registries, 0, sizeof(struct Vector));
+    }
+    snapshots->front = ui_tree;
+    snapshots->back = &snapshots->trees[0];
+    snapshots->pending = &snapshots->trees[1];
+    snapshots->pending_ready = 0;
+    return 0; // Success
+}
+
+// Producer thread: the tree to edit
+struct UI_Tree* NU_Snapshots_Back(struct NU_Tree_Snapshots* snapshots)
+{
+    return snapshots->back;
+}
+
+// Producer thread: makes the edits so far visible to the next swap (a tree published earlier that was
+// never swapped in is replaced). Only what changed since the pending tree's last copy is copied. The back tree
+// stays the producer's and can be edited again right away.
+void NU_Snapshots_Publish(struct NU_Tree_Snapshots* snapshots)
+{
+    SDL_LockMutex(snapshots->mutex);
+    NU_Copy_UI_Tree(snapshots->pending, snapshots->back, 1);
+    snapshots->pending_ready = 1;
+    SDL_UnlockMutex(snapshots->mutex);
+}
+
+// Render thread, between frames: swaps a published tree in as the front tree. The existing windows go to
+// its window nodes in order (windows left over are closed) and the fonts and layout pool move with them.
+// The nodes that still match the old front tree keep its layout results (see NU_Keep_Layout_Results).
+// Never waits for a publish in progress. Returns 1 if the front tree changed (pointers into the old one are
+// invalid), 0 if not.
+int NU_Snapshots_Swap(struct NU_Tree_Snapshots* snapshots, struct Vector* windows, struct Vector* gl_contexts, struct Vector* nano_vg_contexts)
+{
+    if (!SDL_TryLockMutex(snapshots->mutex)) return 0;
+    if (!snapshots->pending_ready)
+    {
+        SDL_UnlockMutex(snapshots->mutex);
+        return 0;
+    }
+    struct UI_Tree* old_front = snapshots->front;
+    struct UI_Tree* front = snapshots->pending;
+    snapshots->front = front;
+    snapshots->pending = old_front;
+    snapshots->pending_ready = 0;
+
+    struct Vector swap = front->font_resources;
+    front->font_resources = old_front->font_resources;
+    old_front->font_resources = swap;
+    swap = front->font_registries;
+    front->font_registries = old_front->font_registries;
+    old_front->font_registries = swap;
+    front->layout_pool = old_front->layout_pool;
+    old_front->layout_pool = NULL;
+
+    NU_Keep_Layout_Results(front, old_front);
+
+    // Every other node draws into its window ancestor's window (clean nodes are not laid out to inherit it)
+    struct Vector old_windows;
+    NU_Collect_Windows(old_front, &old_windows);
+    uint32_t window_count = 0;
+    uint8_t missing_window = 0;
+    for (int l=0; l<=front->deepest_layer; l++)
+    {
+        struct Vector* layer = &front->tree_stack[l];
+        for (uint32_t n=0; n<layer->size; n++)
+        {
+            struct Node* node = Vector_Get(layer, n);
+            struct Node_Cold* cold = Vector_Get(&front->cold_stack[l], n);
+            cold->window = NULL;
+            cold->vg = NULL;
+            if (node->tag == WINDOW && window_count < old_windows.size)
+            {
+                struct Node_Cold* old_window = Vector_Get(&old_windows, window_count++);
+                cold->window = old_window->window;
+                cold->vg = old_window->vg;
+            }
+            else if (node->tag == WINDOW) missing_window = 1;
+            else if (node->tag != NAT && l > 0)
+            {
+                struct Node_Cold* parent_cold = Vector_Get(&front->cold_stack[l-1], node->parent_index);
+                cold->window = parent_cold->window;
+                cold->vg = parent_cold->vg;
+            }
+        }
+    }
+    for (uint32_t i=window_count; i<old_windows.size; i++) {
+        struct Node_Cold* old_window = Vector_Get(&old_windows, i);
+        NU_Close_Window(front, old_window->window, windows, gl_contexts, nano_vg_contexts);
+    }
+    Vector_Free(&old_windows);
+    if (missing_window) NU_Mark_Tree_Dirty(front); // the full layout creates the new windows
+    SDL_UnlockMutex(snapshots->mutex);
+    return 1;
+}
+
+// Frees the memory of all three trees (the fonts and windows stay with the caller)
+void NU_Snapshots_Close(struct NU_Tree_Snapshots* snapshots)
+{
+    NU_Free_UI_Tree_Memory(snapshots->front);
+    NU_Free_UI_Tree_Memory(snapshots->back);
+    NU_Free_UI_Tree_Memory(snapshots->pending);
+    SDL_DestroyMutex(snapshots->mutex);
+}
@@ -1,11 +1,20 @@
 #pragma once
 
+#include "region.h"
+
+// Capacity after a full vector grows (must be larger than capacity for any capacity >= 2). Define it before
+// including vector.h to trade memory for fewer reallocations.
+#ifndef VECTOR_GROWTH
+#define VECTOR_GROWTH(capacity) ((capacity) * 2)
+#endif
+
 struct Vector
 {
     uint32_t capacity;
     uint32_t size;
     void* data;
     size_t element_size;
+    struct Region* region; // NULL == heap
 };
 
 void Vector_Reserve(struct Vector* vector, size_t element_size, uint32_t capacity)
@@ -14,20 +23,53 @@ void Vector_Reserve(struct Vector* vector, size_t element_size, uint32_t capacit
     vector->size = 0;
     vector->element_size = element_size;
     vector->data = malloc(capacity * element_size);
+    vector->region = NULL;
+}
+
+// Reserves the vector in a region (the region owns the memory, growing and freeing go through it)
+void Vector_Reserve_Region(struct Vector* vector, struct Region* region, size_t element_size, uint32_t capacity)
+{
+    vector->capacity = capacity;
+    vector->size = 0;
+    vector->element_size = element_size;
+    vector->data = Region_Alloc(region, capacity * element_size);
+    vector->region = region;
 }
 
 void Vector_Free(struct Vector* vector)
 {
-    free(vector->data);
+    if (vector->region != NULL) {
+        Region_Release(vector->region, vector->data);
+    } else {
+        free(vector->data);
+    }
     vector->data = NULL;
     vector->capacity = 0;
     vector->size = 0;
 }
 
+static void Vector_Grow_To(struct Vector* vector, uint32_t capacity)
+{
+    if (vector->region != NULL) {
+        vector->data = Region_Realloc(vector->region, vector->data, vector->capacity * vector->element_size, capacity * vector->element_size);
+    } else {
+        vector->data = realloc(vector->data, capacity * vector->element_size);
+    }
+    vector->capacity = capacity;
+}
+
 void Vector_Grow(struct Vector* vector)
 {
-    vector->capacity = MAX(vector->capacity * 2, 2);
-    vector->data = realloc(vector->data, vector->capacity * vector->element_size);
+    Vector_Grow_To(vector, MAX(VECTOR_GROWTH(vector->capacity), 2));
+}
+
+// Grows the capacity until it holds size elements (one reallocation)
+static void Vector_Fit(struct Vector* vector, uint32_t size)
+{
+    if (size <= vector->capacity) return;
+    uint32_t capacity = MAX(vector->capacity, 2);
+    while (capacity < size) capacity = VECTOR_GROWTH(capacity);
+    Vector_Grow_To(vector, capacity);
 }
 
 void Vector_Push(struct Vector* vector, const void* element)
@@ -43,4 +85,64 @@ void Vector_Push(struct Vector* vector, const void* element)
 void* Vector_Get(struct Vector* vector, uint32_t index)
 {
     return (char*) vector->data + index * vector->element_size;
-}
\ No newline at end of file
+}
+
+void Vector_Push_Range(struct Vector* vector, const void* elements, uint32_t count)
+{
+    Vector_Fit(vector, vector->size + count);
+    void* destination = (char*)vector->data + vector->size * vector->element_size;
+    memcpy(destination, elements, count * vector->element_size);
+    vector->size += count;
+}
+
+// Sets the size, growing the capacity if needed (new elements are left uninitialised)
+void Vector_Resize(struct Vector* vector, uint32_t size)
+{
+    Vector_Fit(vector, size);
+    vector->size = size;
+}
+
+// Replaces the elements with a copy of src's (same element size, the vector keeps its own memory)
+void Vector_Copy(struct Vector* vector, struct Vector* src)
+{
+    vector->size = 0;
+    Vector_Fit(vector, src->size);
+    memcpy(vector->data, src->data, src->size * vector->element_size);
+    vector->size = src->size;
+}
+
+void Vector_Remove(struct Vector* vector, uint32_t index)
+{
+    char* element = (char*) vector->data + index * vector->element_size;
+    memmove(element, element + vector->element_size, (vector->size - index - 1) * vector->element_size);
+    vector->size -= 1;
+}
+
+// Typed access for vectors on hot paths: VECTOR_DEFINE(Node, struct Node) adds Vector_Get_Node, Vector_Last_Node,
+// Vector_Push_Node and Vector_Push_Range_Node. The vector is the same struct Vector (regions, layers and
+// Vector_Copy work as before) but the element size is known at compile time, so gets compile to one indexed
+// load and pushes to a plain store the compiler can inline and vectorise.
+#define VECTOR_DEFINE(name, type) \
+static inline type* Vector_Get_##name(struct Vector* vector, uint32_t index) \
+{ \
+    return (type*) vector->data + index; \
+} \
+static inline type* Vector_Last_##name(struct Vector* vector) \
+{ \
+    return (type*) vector->data + vector->size - 1; \
+} \
+static inline void Vector_Push_##name(struct Vector* vector, type element) \
+{ \
+    if (vector->size == vector->capacity) Vector_Grow(vector); \
+    ((type*) vector->data)[vector->size++] = element; \
+} \
+static inline void Vector_Push_Range_##name(struct Vector* vector, const type* elements, uint32_t count) \
+{ \
+    Vector_Fit(vector, vector->size + count); \
+    memcpy((type*) vector->data + vector->size, elements, count * sizeof(type)); \
+    vector->size += count; \
+}
+
+VECTOR_DEFINE(Char, char)
+VECTOR_DEFINE(Uint32, uint32_t)
+VECTOR_DEFINE(Float, float)
@@ -7,6 +7,8 @@
 #include "headers/parser.h"
 #include "headers/layout.h"
 #include "headers/resources.h"
+#include "headers/precompiled.h"
+#include "headers/hot_reload.h"
 #include <nu_draw.h>
 
 #define NANOVG_GL3_IMPLEMENTATION
@@ -56,8 +58,8 @@ int main()
     timer_start();
     start_measurement();
 
-    // Parse xml into UI tree
-    if (NU_Parse("test.xml", &ui_tree) != 0)
+    // Load the precompiled UI tree (parses the xml instead if it changed since the last launch)
+    if (NU_Load_Precompiled("test.xml", "test.nub", &ui_tree) != 0)
     {
         return -1;
     }
@@ -89,12 +91,23 @@ int main()
     };
 
     SDL_AddEventWatch(ResizingEventWatcher, &watcher_data);
+
+    // Watch the xml so edits show up without restarting
+    struct NU_Hot_Reload hot_reload;
+    int hot_reload_enabled = NU_Hot_Reload_Init(&hot_reload, "test.xml", &ui_tree) == 0;
+
+    // Lay out large trees on every core
+    struct NU_Layout_Pool layout_pool;
+    int layout_pool_enabled = NU_Layout_Pool_Init(&layout_pool, &ui_tree, 0) == 0;
     
     // Application loop
     int isRunning = 1;
     while (isRunning)
     {
         isRunning = ProcessWindowEvents();
+        if (hot_reload_enabled) {
+            NU_Hot_Reload_Poll(&hot_reload, &ui_tree, &windows, &gl_contexts, &nano_vg_contexts);
+        }
         // Calculate element positions
         // timer_start();
         // start_measurement();
@@ -104,6 +117,12 @@ int main()
     }
 
     // Free Memory
+    if (hot_reload_enabled) {
+        NU_Hot_Reload_Close(&hot_reload);
+    }
+    if (layout_pool_enabled) {
+        NU_Layout_Pool_Close(&layout_pool, &ui_tree);
+    }
     NU_Free_UI_Tree_Memory(&ui_tree);
     Vector_Free(&windows);
     Vector_Free(&gl_contexts);